@@ -0,0 +1,314 @@
+/** @file benchmark_srrender.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Throughput benchmarks for the SRRender2D render paths.
+ *
+ * Sweeps emitter count, image size, sigma, sigmaAccuracy, float/double and thread count over renderHist (with each
+ * Engine and renderHistSparse as engine "Sparse"), renderGauss (with each Engine), renderHistMovie,
+ * renderGaussMovie, renderGaussMovieWindowed, renderGaussMovieStream (to a sink that discards the frames) and
+ * renderGaussBudget (renderGauss with a relative ErrorBudget).
+ * One CSV or JSON record is written to stdout per case, so results can be tracked across commits and used to place
+ * the Single/Parallel crossover.
+ *
+ * Usage: benchmarkSRRender [--points 1e3,1e5] [--sizes 256,1024] [--sigmas 0.5,2] [--accuracies 5] [--budgets 1e-3]
+ *                          [--threads 1,8] [--frames 10] [--movie-max-mb 1024] [--repeats 3]
+ *                          [--precision float|double] [--format csv|json]
+ *                          [--affinity default|close|spread] [--first-touch 0|1]
+ *        benchmarkSRRender --calibrate FILE
+ * Sigmas are in output pixels.  For renderGaussBudget the sigmaAccuracy column holds the budget tolerance.  Movie cases
+ * other than renderGaussMovieStream are skipped if the movie would be larger than movie-max-mb.
+ * Memory is the scratch the render engines allocate for one render (RenderStats::scratchBytes): per-thread images,
+ * tiles, stencils and bins, but not the points or output image.  OPT_BENCHMARK forces OPT_STATS on so it can be
+ * measured; it is -1 if the library was built without SRRENDER_STATS.
+ * Thread counts, affinity and first-touch are applied with a RenderOptionsScope around each case.
+ * --calibrate fits a CostModel on this machine and saves it to FILE for use via SRRENDER_COST_MODEL.
+ */
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "SRRender/SRRender.h"
+
+using namespace srrender;
+
+struct Config {
+    std::vector<double> points = {1e3, 1e4, 1e5, 1e6};
+    std::vector<double> sizes = {256, 1024, 4096};
+    std::vector<double> sigmas = {0.5, 2};
+    std::vector<double> accuracies = {3, 5};
+    std::vector<double> budgets = {1e-3};
+    std::vector<double> threads;
+    double frames = 10;
+    double movieMaxMB = 1024; //Movie cases needing larger movies are skipped
+    int repeats = 3;
+    RenderOptions::Affinity affinity = RenderOptions::Affinity::Default;
+    bool firstTouch = false;
+    bool json = false;
+};
+
+struct Result {
+    std::string method;
+    std::string engine;
+    std::string precision;
+    std::size_t nPoints;
+    std::size_t size;
+    std::size_t frames;
+    double sigma;
+    double sigmaAccuracy;
+    int threads;
+    double minSeconds;
+    double meanSeconds;
+    std::size_t bytes; //Points read plus image bytes written for one render
+    long scratchKB; //Scratch memory of one render, or -1 without RenderStats
+};
+
+std::vector<double> parse_list(const char *arg)
+{
+    std::vector<double> vals;
+    std::stringstream ss(arg);
+    std::string tok;
+    while(std::getline(ss, tok, ',')) vals.push_back(std::stod(tok));
+    return vals;
+}
+
+void write_result(const Result &r, bool json, bool &first)
+{
+    double emittersPerSec = r.nPoints/r.minSeconds;
+    double bytesPerSec = r.bytes/r.minSeconds;
+    if(json) {
+        std::printf("%s{\"method\":\"%s\",\"engine\":\"%s\",\"precision\":\"%s\",\"points\":%zu,\"size\":%zu,\"frames\":%zu,"
+                    "\"sigma\":%g,\"sigmaAccuracy\":%g,\"threads\":%d,\"min_s\":%.6g,\"mean_s\":%.6g,"
+                    "\"emitters_per_s\":%.6g,\"bytes_per_s\":%.6g,\"scratch_kb\":%ld}",
+                    first ? "[\n" : ",\n", r.method.c_str(), r.engine.c_str(), r.precision.c_str(), r.nPoints, r.size,
+                    r.frames, r.sigma, r.sigmaAccuracy, r.threads, r.minSeconds, r.meanSeconds, emittersPerSec,
+                    bytesPerSec, r.scratchKB);
+    } else {
+        if(first) std::printf("method,engine,precision,points,size,frames,sigma,sigmaAccuracy,threads,"
+                              "min_s,mean_s,emitters_per_s,bytes_per_s,scratch_kb\n");
+        std::printf("%s,%s,%s,%zu,%zu,%zu,%g,%g,%d,%.6g,%.6g,%.6g,%.6g,%ld\n",
+                    r.method.c_str(), r.engine.c_str(), r.precision.c_str(), r.nPoints, r.size, r.frames, r.sigma,
+                    r.sigmaAccuracy, r.threads, r.minSeconds, r.meanSeconds, emittersPerSec, bytesPerSec, r.scratchKB);
+    }
+    first = false;
+    std::fflush(stdout);
+}
+
+/* Time render() over repeats runs after one warm-up run, which also records the scratch memory when available */
+template<class RenderFuncT>
+void time_render(RenderFuncT render, int repeats, Result &r)
+{
+    {
+        RenderStats stats;
+        RenderStatsScope scope(stats);
+        render();
+        r.scratchKB = RenderStats::Enabled ? static_cast<long>((stats.scratchBytes+1023)/1024) : -1;
+    }
+    double total = 0;
+    r.minSeconds = 1e300;
+    for(int k=0; k<repeats; k++) {
+        auto start = std::chrono::steady_clock::now();
+        render();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        r.minSeconds = std::min(r.minSeconds, secs);
+        total += secs;
+    }
+    r.meanSeconds = total/repeats;
+}
+
+/* Uniform random points [I X Y sigmaX sigmaY Frame] over a size x size ROI rendered at one unit per pixel */
+template<class FloatT>
+arma::Mat<FloatT> simulate_points(std::size_t nPoints, double size, double sigma, std::size_t frames)
+{
+    std::mt19937_64 generator(nPoints);
+    std::uniform_real_distribution<double> pos(0., size);
+    std::uniform_int_distribution<std::size_t> frame(0, frames-1);
+    arma::Mat<FloatT> points(nPoints,6);
+    for(std::size_t n=0; n<nPoints; n++) {
+        points(n,0) = 1;
+        points(n,1) = pos(generator);
+        points(n,2) = pos(generator);
+        points(n,3) = sigma;
+        points(n,4) = sigma;
+        points(n,5) = frame(generator);
+    }
+    return points;
+}
+
+/* A copy of points with the rows stably sorted by frame, as the MovieStream renderers need */
+template<class FloatT>
+arma::Mat<FloatT> sort_by_frame(const arma::Mat<FloatT> &points)
+{
+    std::vector<arma::uword> order(points.n_rows);
+    for(arma::uword n=0; n<points.n_rows; n++) order[n] = n;
+    std::stable_sort(order.begin(), order.end(), [&](arma::uword a, arma::uword b) { return points(a,5) < points(b,5); });
+    arma::Mat<FloatT> sorted(points.n_rows, points.n_cols);
+    for(arma::uword c=0; c<points.n_cols; c++) for(arma::uword n=0; n<points.n_rows; n++) sorted(n,c) = points(order[n],c);
+    return sorted;
+}
+
+template<class FloatT>
+void benchmark(const Config &config, const char *precision, bool &first)
+{
+    using RenderT = SRRender2D<FloatT>;
+    using Engine = typename RenderT::Engine;
+    const std::pair<Engine,const char*> engines[] = {{Engine::Single,"Single"}, {Engine::Parallel,"Parallel"},
+                                                    {Engine::Tiled,"Tiled"}};
+    const std::pair<Engine,const char*> gaussEngines[] = {{Engine::Single,"Single"}, {Engine::Parallel,"Parallel"},
+                                                         {Engine::Tiled,"Tiled"}, {Engine::FFT,"FFT"}};
+    for(double nPointsD: config.points) for(double sizeD: config.sizes) for(double threadsD: config.threads) {
+        std::size_t nPoints = static_cast<std::size_t>(nPointsD);
+        std::size_t size = static_cast<std::size_t>(sizeD);
+        std::size_t frames = static_cast<std::size_t>(config.frames);
+        int threads = static_cast<int>(threadsD);
+        RenderOptions options;
+        options.threads = threads;
+        options.affinity = config.affinity;
+        options.firstTouch = config.firstTouch;
+        RenderOptionsScope optionsScope(options);
+        typename RenderT::VecT roi = {0, static_cast<FloatT>(size), 0, static_cast<FloatT>(size)};
+        Result r;
+        r.precision = precision;
+        r.nPoints = nPoints;
+        r.size = size;
+        r.threads = threads;
+        std::size_t imageBytes = size*size*sizeof(FloatT);
+        bool renderMovies = imageBytes*frames <= config.movieMaxMB*(1<<20);
+        for(std::size_t s=0; s<config.sigmas.size(); s++) {
+            auto points = simulate_points<FloatT>(nPoints, sizeD, config.sigmas[s], frames);
+            auto framePoints = sort_by_frame(points);
+            r.sigma = config.sigmas[s];
+            if(s==0) { //Histograms do not depend on sigma
+                typename RenderT::ImageT im(size,size);
+                r.sigmaAccuracy = 0;
+                r.frames = 1;
+                r.method = "renderHist";
+                r.bytes = nPoints*3*sizeof(FloatT) + imageBytes;
+                for(auto &e: engines) {
+                    r.engine = e.second;
+                    time_render([&]{ RenderT::renderHist(points, roi, im, e.first); }, config.repeats, r);
+                    write_result(r, config.json, first);
+                }
+                r.engine = "Sparse";
+                time_render([&]{ RenderT::renderHistSparse(points, roi, im); }, config.repeats, r);
+                write_result(r, config.json, first);
+                im.reset();
+                if(renderMovies) {
+                    typename RenderT::MovieT movie(size,size,frames);
+                    r.method = "renderHistMovie";
+                    r.engine = "Stripes";
+                    r.frames = frames;
+                    r.bytes = nPoints*4*sizeof(FloatT) + imageBytes*frames;
+                    time_render([&]{ movie.zeros(); RenderT::renderHistMovie(points, roi, movie); }, config.repeats, r);
+                    write_result(r, config.json, first);
+                }
+            }
+            for(double tolerance: config.budgets) {
+                typename RenderT::ImageT im(size,size);
+                typename RenderT::ErrorBudget budget;
+                budget.tolerance = static_cast<FloatT>(tolerance);
+                r.sigmaAccuracy = tolerance;
+                r.method = "renderGaussBudget";
+                r.engine = "Auto";
+                r.frames = 1;
+                r.bytes = nPoints*5*sizeof(FloatT) + imageBytes;
+                time_render([&]{ RenderT::renderGauss(points, roi, im, budget); }, config.repeats, r);
+                write_result(r, config.json, first);
+            }
+            for(double accuracy: config.accuracies) {
+                r.sigmaAccuracy = accuracy;
+                {
+                    typename RenderT::ImageT im(size,size);
+                    r.method = "renderGauss";
+                    r.frames = 1;
+                    r.bytes = nPoints*5*sizeof(FloatT) + imageBytes;
+                    for(auto &e: gaussEngines) {
+                        r.engine = e.second;
+                        time_render([&]{ RenderT::renderGauss(points, roi, im, accuracy, e.first); }, config.repeats, r);
+                        write_result(r, config.json, first);
+                    }
+                }
+                //Streamed movies hold only the frames in flight, so they are not limited by movie-max-mb
+                r.method = "renderGaussMovieStream";
+                r.engine = "Stripes";
+                r.frames = frames;
+                r.bytes = nPoints*6*sizeof(FloatT) + imageBytes*frames;
+                time_render([&]{ RenderT::renderGaussMovieStream(framePoints, roi, size, size, frames,
+                                                                 [](uint32_t, const typename RenderT::ImageT&) {},
+                                                                 accuracy); },
+                            config.repeats, r);
+                write_result(r, config.json, first);
+                if(!renderMovies) continue;
+                typename RenderT::MovieT movie(size,size,frames);
+                r.method = "renderGaussMovie";
+                r.engine = "Stripes";
+                r.frames = frames;
+                r.bytes = nPoints*6*sizeof(FloatT) + imageBytes*frames;
+                time_render([&]{ movie.zeros(); RenderT::renderGaussMovie(points, roi, movie, accuracy); },
+                            config.repeats, r);
+                write_result(r, config.json, first);
+                //Sliding windows of half the frames at stride 1
+                std::size_t window = std::max<std::size_t>(1, frames/2);
+                typename RenderT::MovieT windowed(size,size,frames-window+1);
+                r.method = "renderGaussMovieWindowed";
+                r.engine = "Prefix";
+                r.frames = windowed.n_slices;
+                r.bytes = nPoints*6*sizeof(FloatT) + imageBytes*windowed.n_slices;
+                time_render([&]{ RenderT::renderGaussMovieWindowed(points, roi, windowed, window, 1, accuracy); },
+                            config.repeats, r);
+                write_result(r, config.json, first);
+            }
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    Config config;
+    std::vector<std::string> precisions = {"float", "double"};
+    for(int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        if(i+1>=argc) { std::cerr<<"Missing value for "<<arg<<"\n"; return EXIT_FAILURE; }
+        const char *val = argv[++i];
+        if(arg=="--calibrate") {
+            CostModel::calibrate().save(val);
+            return EXIT_SUCCESS;
+        }
+        else if(arg=="--points") config.points = parse_list(val);
+        else if(arg=="--sizes") config.sizes = parse_list(val);
+        else if(arg=="--sigmas") config.sigmas = parse_list(val);
+        else if(arg=="--accuracies") config.accuracies = parse_list(val);
+        else if(arg=="--budgets") config.budgets = parse_list(val);
+        else if(arg=="--threads") config.threads = parse_list(val);
+        else if(arg=="--frames") config.frames = std::max(1., std::stod(val));
+        else if(arg=="--movie-max-mb") config.movieMaxMB = std::stod(val);
+        else if(arg=="--repeats") config.repeats = std::max(1, std::stoi(val));
+        else if(arg=="--format") config.json = std::string(val)=="json";
+        else if(arg=="--precision") precisions = {val};
+        else if(arg=="--first-touch") config.firstTouch = std::stoi(val)!=0;
+        else if(arg=="--affinity") {
+            std::string a = val;
+            if(a=="close") config.affinity = RenderOptions::Affinity::Close;
+            else if(a=="spread") config.affinity = RenderOptions::Affinity::Spread;
+            else if(a!="default") { std::cerr<<"Unknown affinity "<<a<<"\n"; return EXIT_FAILURE; }
+        }
+        else { std::cerr<<"Unknown argument "<<arg<<"\n"; return EXIT_FAILURE; }
+    }
+    if(config.threads.empty()) {
+        int maxThreads = omp_get_max_threads();
+        for(int t=1; t<maxThreads; t*=2) config.threads.push_back(t);
+        config.threads.push_back(maxThreads);
+    }
+    bool first = true;
+    for(auto &p: precisions) {
+        if(p=="float") benchmark<float>(config, "float", first);
+        else if(p=="double") benchmark<double>(config, "double", first);
+    }
+    if(config.json) std::printf("%s]\n", first ? "[" : "\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/** @file ImageWriter.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Image outputs for the srrender command line renderer.
+ */
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "SRRender/SRRender.h"
+#include "ImageWriter.h"
+
+namespace srrender {
+namespace cli {
+
+namespace {
+
+enum TiffType : std::uint16_t {Short=3, Long=4, Long8=16};
+
+struct TiffEntry {
+    std::uint16_t tag;
+    std::uint16_t type;
+    std::vector<std::uint64_t> values;
+};
+
+std::size_t type_size(std::uint16_t type) { return type==Short ? 2 : type==Long ? 4 : 8; }
+
+template<class T>
+void put(std::ofstream &out, T value) { out.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+void put_value(std::ofstream &out, std::uint16_t type, std::uint64_t value)
+{
+    if(type==Short) put(out, static_cast<std::uint16_t>(value));
+    else if(type==Long) put(out, static_cast<std::uint32_t>(value));
+    else put(out, value);
+}
+
+void pad_to(std::ofstream &out, std::streamoff alignment)
+{
+    while(out.tellp()%alignment) out.put('\0');
+}
+
+} /* namespace */
+
+/* Layout: header, pixel strips, any tag arrays too long to store inline, then the single IFD, whose offset is
+ * patched into the header last.  Classic TIFF has 32-bit offsets and 12 byte entries with 4 bytes inline; BigTIFF
+ * has 64-bit offsets and 20 byte entries with 8 bytes inline.
+ */
+template<class FloatT>
+void write_tiff(const std::string &path, const arma::Mat<FloatT> &im, bool bigTiff)
+{
+    if(im.n_elem==0) throw SRRenderError("BadImageSize","Cannot write an empty image");
+    std::uint64_t rows = im.n_rows, cols = im.n_cols;
+    std::uint64_t rowBytes = cols*sizeof(FloatT);
+    std::uint64_t rowsPerStrip = std::min<std::uint64_t>(rows, std::max<std::uint64_t>(1, (1<<20)/rowBytes));
+    std::uint64_t nStrips = (rows+rowsPerStrip-1)/rowsPerStrip;
+    std::uint64_t dataBytes = rows*rowBytes;
+    if(dataBytes + 16*nStrips + 1024 > std::numeric_limits<std::uint32_t>::max()) bigTiff = true;
+    if(cols>std::numeric_limits<std::uint32_t>::max() || rows>std::numeric_limits<std::uint32_t>::max())
+        throw SRRenderError("BadImageSize","TIFF images are limited to 2^32-1 pixels on a side");
+
+    std::ofstream out(path, std::ios::binary);
+    if(!out) throw SRRenderError("FileError","Cannot create "+path);
+    out.write("II", 2);
+    std::streamoff headerOffset;
+    if(bigTiff) {
+        put<std::uint16_t>(out, 43);
+        put<std::uint16_t>(out, 8);
+        put<std::uint16_t>(out, 0);
+        headerOffset = out.tellp();
+        put<std::uint64_t>(out, 0);
+    } else {
+        put<std::uint16_t>(out, 42);
+        headerOffset = out.tellp();
+        put<std::uint32_t>(out, 0);
+    }
+
+    std::uint64_t dataStart = out.tellp();
+    std::vector<std::uint64_t> offsets(nStrips), counts(nStrips);
+    for(std::uint64_t s=0; s<nStrips; s++) {
+        offsets[s] = dataStart + s*rowsPerStrip*rowBytes;
+        counts[s] = std::min(rowsPerStrip, rows-s*rowsPerStrip)*rowBytes;
+    }
+    std::vector<FloatT> row(cols);
+    for(arma::uword y=0; y<rows; y++) { //im is column-major, TIFF is row-major
+        for(arma::uword x=0; x<cols; x++) row[x] = im(y,x);
+        out.write(reinterpret_cast<const char*>(row.data()), rowBytes);
+    }
+
+    std::uint16_t offsetType = bigTiff ? Long8 : Long;
+    std::vector<TiffEntry> entries = {
+        {256, Long, {cols}},                            //ImageWidth
+        {257, Long, {rows}},                            //ImageLength
+        {258, Short, {8*sizeof(FloatT)}},               //BitsPerSample
+        {259, Short, {1}},                              //Compression: none
+        {262, Short, {1}},                              //PhotometricInterpretation: BlackIsZero
+        {273, offsetType, offsets},                     //StripOffsets
+        {277, Short, {1}},                              //SamplesPerPixel
+        {278, Long, {rowsPerStrip}},                    //RowsPerStrip
+        {279, offsetType, counts},                      //StripByteCounts
+        {339, Short, {3}}                               //SampleFormat: IEEE floating point
+    };
+    std::size_t inlineBytes = bigTiff ? 8 : 4;
+    std::vector<std::uint64_t> arrayOffsets(entries.size(), 0);
+    for(std::size_t e=0; e<entries.size(); e++) {
+        if(entries[e].values.size()*type_size(entries[e].type) <= inlineBytes) continue;
+        pad_to(out, 8);
+        arrayOffsets[e] = out.tellp();
+        for(auto v: entries[e].values) put_value(out, entries[e].type, v);
+    }
+
+    pad_to(out, 8);
+    std::uint64_t ifdOffset = out.tellp();
+    if(bigTiff) put<std::uint64_t>(out, entries.size());
+    else put<std::uint16_t>(out, static_cast<std::uint16_t>(entries.size()));
+    for(std::size_t e=0; e<entries.size(); e++) {
+        const TiffEntry &entry = entries[e];
+        put(out, entry.tag);
+        put(out, entry.type);
+        if(bigTiff) put<std::uint64_t>(out, entry.values.size());
+        else put<std::uint32_t>(out, static_cast<std::uint32_t>(entry.values.size()));
+        std::streamoff fieldStart = out.tellp();
+        if(arrayOffsets[e]) {
+            if(bigTiff) put<std::uint64_t>(out, arrayOffsets[e]);
+            else put<std::uint32_t>(out, static_cast<std::uint32_t>(arrayOffsets[e]));
+        } else {
+            for(auto v: entry.values) put_value(out, entry.type, v);
+        }
+        while(out.tellp()-fieldStart < static_cast<std::streamoff>(inlineBytes)) out.put('\0');
+    }
+    if(bigTiff) put<std::uint64_t>(out, 0);
+    else put<std::uint32_t>(out, 0);
+
+    out.seekp(headerOffset);
+    if(bigTiff) put<std::uint64_t>(out, ifdOffset);
+    else put<std::uint32_t>(out, static_cast<std::uint32_t>(ifdOffset));
+    if(!out) throw SRRenderError("FileError","Failed writing "+path);
+}
+
+template<class FloatT>
+MappedImageFile<FloatT>::MappedImageFile(const std::string &path_, std::size_t rows, std::size_t cols)
+    : path(path_), num_bytes(rows*cols*sizeof(FloatT))
+{
+    if(num_bytes==0) throw SRRenderError("BadImageSize","Cannot map an empty image");
+#ifdef _WIN32
+    fallback.resize(rows*cols);
+    memory = fallback.data();
+#else
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd<0) throw SRRenderError("FileError","Cannot create "+path);
+    if(::ftruncate(fd, static_cast<off_t>(num_bytes))) {
+        ::close(fd);
+        throw SRRenderError("FileError","Cannot resize "+path+" to "+std::to_string(num_bytes)+" bytes");
+    }
+    void *mapped = ::mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapped==MAP_FAILED) {
+        ::close(fd);
+        throw SRRenderError("FileError","Cannot map "+path);
+    }
+    memory = static_cast<FloatT*>(mapped);
+#endif
+}
+
+template<class FloatT>
+MappedImageFile<FloatT>::~MappedImageFile()
+{
+    try {
+        close();
+    } catch(...) { }
+}
+
+template<class FloatT>
+void MappedImageFile<FloatT>::close()
+{
+    if(!memory) return;
+#ifdef _WIN32
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(memory), num_bytes);
+    memory = nullptr;
+    fallback = std::vector<FloatT>();
+    if(!out) throw SRRenderError("FileError","Failed writing "+path);
+#else
+    ::munmap(memory, num_bytes);
+    memory = nullptr;
+    ::close(fd);
+    fd = -1;
+#endif
+}
+
+/* Explicit Template Instantiation */
+template void write_tiff(const std::string &path, const arma::Mat<float> &im, bool bigTiff);
+template void write_tiff(const std::string &path, const arma::Mat<double> &im, bool bigTiff);
+template class MappedImageFile<float>;
+template class MappedImageFile<double>;
+
+} /* namespace srrender::cli */
+} /* namespace srrender */
@@ -0,0 +1,52 @@
+/** @file ImageWriter.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Image outputs for the srrender command line renderer.
+ */
+
+#ifndef SRRENDER_CLI_IMAGEWRITER_H
+#define SRRENDER_CLI_IMAGEWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <armadillo>
+
+namespace srrender {
+namespace cli {
+
+/** Write im as a single-channel IEEE floating point TIFF with one image row per im row.
+ * BigTIFF is used if bigTiff is set or the image is too large for a classic TIFF. */
+template<class FloatT>
+void write_tiff(const std::string &path, const arma::Mat<FloatT> &im, bool bigTiff=false);
+
+/**
+ * A raw image file of rows x cols column-major values, mapped into memory so a render writes the file directly.
+ *
+ * The file has no header, so in Matlab: im = fread(fid, [rows cols], 'single=>single').  Where memory mapping is
+ * not available the image is held in memory and written by close().
+ */
+template<class FloatT>
+class MappedImageFile {
+public:
+    MappedImageFile(const std::string &path, std::size_t rows, std::size_t cols);
+    ~MappedImageFile();
+    MappedImageFile(const MappedImageFile&) = delete;
+    MappedImageFile& operator=(const MappedImageFile&) = delete;
+
+    FloatT* data() { return memory; }
+    /** Flush the image to the file and release it.  data() is invalid afterwards. */
+    void close();
+
+private:
+    std::string path;
+    std::size_t num_bytes;
+    FloatT *memory = nullptr;
+    int fd = -1;
+    std::vector<FloatT> fallback; //Image memory where mapping is not available
+};
+
+} /* namespace srrender::cli */
+} /* namespace srrender */
+
+#endif /* SRRENDER_CLI_IMAGEWRITER_H */
@@ -0,0 +1,197 @@
+/** @file LocalizationReader.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Chunked readers for localization files used by the srrender command line renderer.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "SRRender/SRRender.h"
+#include "LocalizationReader.h"
+
+namespace srrender {
+namespace cli {
+
+namespace {
+
+bool is_little_endian()
+{
+    std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first==1;
+}
+
+void check_little_endian()
+{
+    if(!is_little_endian()) throw SRRenderError("Unsupported","SRL files can only be used on little-endian machines");
+}
+
+bool is_space(char c) { return c==' ' || c=='\t' || c=='\r'; }
+
+} /* namespace */
+
+CSVReader::CSVReader(const std::string &path_, const std::vector<std::size_t> &columns)
+    : LocalizationReader(columns), path(path_), buffer(1<<20)
+{
+    if(columns.empty()) throw SRRenderError("BadColumns","At least one column must be selected");
+    max_column = *std::max_element(columns.begin(), columns.end());
+    in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    in.open(path);
+    if(!in) throw SRRenderError("FileError","Cannot open "+path);
+}
+
+/* Advance to the next line holding data, skipping blank lines, comments and a header line */
+bool CSVReader::next_line()
+{
+    while(std::getline(in, line)) {
+        line_number++;
+        std::size_t start = 0;
+        while(start<line.size() && is_space(line[start])) start++;
+        if(start==line.size() || line[start]=='#') continue;
+        if(!header_checked) { //Only the first non-comment line may be a header
+            header_checked = true;
+            char *end;
+            std::strtod(line.c_str()+start, &end);
+            if(end==line.c_str()+start) continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool CSVReader::read(arma::mat &chunk, std::size_t maxRows)
+{
+    std::vector<double> values(max_column+1);
+    std::vector<bool> selected(max_column+1, false);
+    for(auto c: columns) selected[c] = true;
+    chunk.set_size(maxRows, columns.size());
+    std::size_t n = 0;
+    for(; n<maxRows && next_line(); n++) {
+        const char *p = line.c_str();
+        for(std::size_t f=0; f<=max_column; f++) {
+            while(is_space(*p)) p++;
+            if(*p=='\0' || *p==',')
+                throw SRRenderError("BadCSV", path+":"+std::to_string(line_number)+": missing column "+std::to_string(f));
+            if(selected[f]) {
+                char *end;
+                values[f] = std::strtod(p, &end);
+                if(end==p)
+                    throw SRRenderError("BadCSV", path+":"+std::to_string(line_number)+": column "+std::to_string(f)+
+                                                  " is not a number");
+                p = end;
+            } else {
+                while(*p!='\0' && *p!=',' && !is_space(*p)) p++;
+            }
+            while(is_space(*p)) p++;
+            if(*p==',') p++;
+        }
+        for(std::size_t k=0; k<columns.size(); k++) chunk(n,k) = values[columns[k]];
+    }
+    if(n<maxRows) chunk.shed_rows(n, maxRows-1);
+    rows_read += n;
+    return n>0;
+}
+
+const char SRLReader::Magic[8] = {'S','R','L','O','C','\0','\0','\1'};
+
+SRLReader::SRLReader(const std::string &path_, const std::vector<std::size_t> &columns)
+    : LocalizationReader(columns), path(path_)
+{
+    check_little_endian();
+    in.open(path, std::ios::binary);
+    if(!in) throw SRRenderError("FileError","Cannot open "+path);
+    char magic[sizeof(Magic)];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&num_columns), sizeof(num_columns));
+    in.read(reinterpret_cast<char*>(&value_bytes), sizeof(value_bytes));
+    if(!in || std::memcmp(magic, Magic, sizeof(Magic))) throw SRRenderError("BadSRL", path+" is not an SRL file");
+    if(value_bytes!=4 && value_bytes!=8)
+        throw SRRenderError("BadSRL", path+": unsupported value size "+std::to_string(value_bytes));
+    for(auto c: columns) if(c>=num_columns)
+        throw SRRenderError("BadColumns", path+" has only "+std::to_string(num_columns)+" columns");
+    block_data = in.tellg();
+}
+
+/* Seek past the current block and read the next block's row count */
+bool SRLReader::next_block()
+{
+    in.seekg(block_data + static_cast<std::streamoff>(num_columns*block_rows*value_bytes));
+    std::uint64_t rows;
+    in.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+    if(in.gcount()==0) return false;
+    if(!in) throw SRRenderError("BadSRL", path+": truncated block header");
+    block_data = in.tellg();
+    block_rows = rows;
+    block_pos = 0;
+    return true;
+}
+
+bool SRLReader::read(arma::mat &chunk, std::size_t maxRows)
+{
+    chunk.set_size(maxRows, columns.size());
+    std::size_t n = 0;
+    while(n<maxRows) {
+        if(block_pos==block_rows && !next_block()) break;
+        std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(maxRows-n, block_rows-block_pos));
+        buffer.resize(count*value_bytes);
+        for(std::size_t k=0; k<columns.size(); k++) {
+            in.seekg(block_data + static_cast<std::streamoff>((columns[k]*block_rows+block_pos)*value_bytes));
+            in.read(buffer.data(), buffer.size());
+            if(!in) throw SRRenderError("BadSRL", path+": truncated block");
+            double *out = chunk.colptr(k)+n;
+            if(value_bytes==4) {
+                const float *vals = reinterpret_cast<const float*>(buffer.data());
+                std::copy(vals, vals+count, out);
+            } else {
+                std::memcpy(out, buffer.data(), buffer.size());
+            }
+        }
+        n += count;
+        block_pos += count;
+    }
+    if(n<maxRows) chunk.shed_rows(n, maxRows-1);
+    rows_read += n;
+    return n>0;
+}
+
+std::unique_ptr<LocalizationReader> open_localizations(const std::string &path, const std::vector<std::size_t> &columns)
+{
+    std::string ext = path.size()>=4 ? path.substr(path.size()-4) : "";
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if(ext==".srl") return std::unique_ptr<LocalizationReader>(new SRLReader(path, columns));
+    return std::unique_ptr<LocalizationReader>(new CSVReader(path, columns));
+}
+
+std::size_t write_srl(const std::string &path, LocalizationReader &reader, std::size_t chunkRows, bool singlePrecision)
+{
+    check_little_endian();
+    std::ofstream out(path, std::ios::binary);
+    if(!out) throw SRRenderError("FileError","Cannot create "+path);
+    std::uint32_t nColumns = static_cast<std::uint32_t>(reader.get_columns().size());
+    std::uint32_t valueBytes = singlePrecision ? 4 : 8;
+    out.write(SRLReader::Magic, sizeof(SRLReader::Magic));
+    out.write(reinterpret_cast<const char*>(&nColumns), sizeof(nColumns));
+    out.write(reinterpret_cast<const char*>(&valueBytes), sizeof(valueBytes));
+    arma::mat chunk;
+    std::vector<float> single;
+    std::size_t total = 0;
+    while(reader.read(chunk, chunkRows)) {
+        std::uint64_t rows = chunk.n_rows;
+        out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+        for(arma::uword k=0; k<chunk.n_cols; k++) {
+            if(singlePrecision) {
+                single.assign(chunk.colptr(k), chunk.colptr(k)+rows);
+                out.write(reinterpret_cast<const char*>(single.data()), rows*sizeof(float));
+            } else {
+                out.write(reinterpret_cast<const char*>(chunk.colptr(k)), rows*sizeof(double));
+            }
+        }
+        total += rows;
+    }
+    if(!out) throw SRRenderError("FileError","Failed writing "+path);
+    return total;
+}
+
+} /* namespace srrender::cli */
+} /* namespace srrender */
@@ -0,0 +1,100 @@
+/** @file LocalizationReader.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Chunked readers for localization files used by the srrender command line renderer.
+ *
+ * Two input formats are supported:
+ *  - CSV: one localization per line, comma, tab or space separated.  Blank lines and lines starting with '#' are
+ *    skipped, and the first other line is taken as a header if it does not start with a number.
+ *  - SRL: a compact binary columnar format, written by srrender --convert.  All values are little-endian.
+ *      header: char magic[8]="SRLOC\0\0\1", uint32 nColumns, uint32 valueBytes (4: float32, 8: float64)
+ *      blocks: uint64 nRows, then nColumns columns of nRows values each, repeated until end of file
+ *    Blocks let the file be written in one streaming pass and read a column at a time without parsing.
+ */
+
+#ifndef SRRENDER_CLI_LOCALIZATIONREADER_H
+#define SRRENDER_CLI_LOCALIZATIONREADER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <armadillo>
+
+namespace srrender {
+namespace cli {
+
+/**
+ * Reads a localization file in chunks of rows, keeping only the selected columns.
+ *
+ * Chunk column k holds file column columns[k].  Each call to read() replaces the chunk, so a reader can feed a
+ * render pipeline without ever holding the whole file in memory.
+ */
+class LocalizationReader {
+public:
+    explicit LocalizationReader(const std::vector<std::size_t> &columns) : columns(columns) {}
+    virtual ~LocalizationReader() = default;
+
+    /** Read the next maxRows rows, or fewer at the end of the input.  Returns false once the input is exhausted. */
+    virtual bool read(arma::mat &chunk, std::size_t maxRows) = 0;
+
+    std::size_t get_rows_read() const { return rows_read; }
+    const std::vector<std::size_t>& get_columns() const { return columns; }
+
+protected:
+    std::vector<std::size_t> columns;
+    std::size_t rows_read = 0;
+};
+
+class CSVReader : public LocalizationReader {
+public:
+    CSVReader(const std::string &path, const std::vector<std::size_t> &columns);
+    bool read(arma::mat &chunk, std::size_t maxRows) override;
+
+private:
+    std::string path;
+    std::ifstream in;
+    std::vector<char> buffer; //Stream buffer, larger than the default to cut read calls
+    std::string line;
+    std::size_t line_number = 0;
+    std::size_t max_column;
+    bool header_checked = false;
+
+    bool next_line();
+};
+
+class SRLReader : public LocalizationReader {
+public:
+    static const char Magic[8];
+
+    SRLReader(const std::string &path, const std::vector<std::size_t> &columns);
+    bool read(arma::mat &chunk, std::size_t maxRows) override;
+
+    std::uint32_t get_num_columns() const { return num_columns; }
+
+private:
+    std::string path;
+    std::ifstream in;
+    std::uint32_t num_columns = 0;
+    std::uint32_t value_bytes = 0;
+    std::uint64_t block_rows = 0; //Rows in the current block
+    std::uint64_t block_pos = 0; //Rows of the current block already read
+    std::streamoff block_data = 0; //File offset of the current block's first column
+    std::vector<char> buffer;
+
+    bool next_block();
+};
+
+/** Open path with the reader for its extension: .srl files are SRL and anything else is CSV */
+std::unique_ptr<LocalizationReader> open_localizations(const std::string &path, const std::vector<std::size_t> &columns);
+
+/** Copy every remaining row of reader to an SRL file at path with one block per chunk of chunkRows rows.
+ * Returns the number of rows written. */
+std::size_t write_srl(const std::string &path, LocalizationReader &reader, std::size_t chunkRows,
+                      bool singlePrecision=true);
+
+} /* namespace srrender::cli */
+} /* namespace srrender */
+
+#endif /* SRRENDER_CLI_LOCALIZATIONREADER_H */
@@ -0,0 +1,250 @@
+/** @file srrender_cli.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Command line renderer for localization files too large to load at once.
+ *
+ * A reader thread parses the input in chunks of rows into a bounded queue while the main thread renders each chunk
+ * into an SRAccumulator2D, so parsing and rendering overlap and memory is bounded by the queue depth rather than the
+ * file size.  Inputs are CSV or SRL files (see LocalizationReader.h).  The image is written as a 32/64-bit float
+ * TIFF, switching to BigTIFF for images over 4GB, or rendered directly into a memory-mapped .raw file of
+ * pixelsY x pixelsX column-major values with no header.
+ *
+ * Usage: srrender --input FILE --roi xmin,xmax,ymin,ymax --pixels X,Y --output IMAGE.tif|IMAGE.raw
+ *                 [--mode gauss|hist] [--sigma-accuracy 5] [--sigma S] [--columns 0,1,2,3,4]
+ *                 [--chunk-rows 1e6] [--queue-depth 2] [--threads N] [--precision float|double] [--bigtiff 0|1]
+ *        srrender --input FILE --convert OUT.srl [--columns 0,1,2,3,4] [--chunk-rows 1e6] [--precision float|double]
+ * --columns gives the input columns of I, X, Y and optionally sigmaX and sigmaY.  --sigma renders every point with
+ * the same sigma, so only I, X and Y columns are needed.  --convert copies the selected columns to an SRL file in
+ * the standard [I X Y sigmaX sigmaY] order.
+ */
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SRRender/SRAccumulator2D.h"
+#include "LocalizationReader.h"
+#include "ImageWriter.h"
+
+using namespace srrender;
+using namespace srrender::cli;
+
+struct Config {
+    std::string input;
+    std::string output;
+    std::string convert;
+    std::vector<double> roi;
+    std::vector<double> pixels;
+    std::vector<std::size_t> columns = {0, 1, 2, 3, 4};
+    bool gauss = true;
+    double sigmaAccuracy = SRRender2D<double>::DefaultSigmaAccuracy;
+    double sigma = 0;
+    std::size_t chunkRows = 1000000;
+    std::size_t queueDepth = 2;
+    int threads = 0;
+    bool single = true;
+    bool bigTiff = false;
+};
+
+/** A bounded FIFO between the reader thread and the renderer.  close() wakes both sides. */
+template<class T>
+class ChunkQueue {
+public:
+    explicit ChunkQueue(std::size_t depth) : depth(depth) {}
+
+    /** Blocks while full.  Returns false if the queue was closed. */
+    bool push(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&]{ return closed || items.size()<depth; });
+        if(closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    /** Blocks while empty.  Returns false once the queue is closed and drained. */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&]{ return closed || !items.empty(); });
+        if(items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    std::size_t depth;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+std::vector<double> parse_list(const char *arg)
+{
+    std::vector<double> vals;
+    std::stringstream ss(arg);
+    std::string tok;
+    while(std::getline(ss, tok, ',')) vals.push_back(std::stod(tok));
+    return vals;
+}
+
+bool ends_with(const std::string &s, const std::string &suffix)
+{
+    return s.size()>=suffix.size() && s.compare(s.size()-suffix.size(), suffix.size(), suffix)==0;
+}
+
+template<class FloatT>
+void render(const Config &config)
+{
+    using AccumulatorT = SRAccumulator2D<FloatT>;
+    using Mode = typename AccumulatorT::Mode;
+    using IdxT = uint32_t;
+    typename AccumulatorT::VecT roi(4);
+    for(int i=0; i<4; i++) roi(i) = static_cast<FloatT>(config.roi[i]);
+    IdxT pixelsX = static_cast<IdxT>(config.pixels[0]), pixelsY = static_cast<IdxT>(config.pixels[1]);
+    Mode mode = config.gauss ? Mode::Gauss : Mode::Hist;
+    FloatT sigmaAccuracy = static_cast<FloatT>(config.sigmaAccuracy);
+    bool raw = ends_with(config.output, ".raw");
+
+    std::unique_ptr<MappedImageFile<FloatT>> rawFile;
+    std::unique_ptr<AccumulatorT> accumulator;
+    if(raw) {
+        rawFile.reset(new MappedImageFile<FloatT>(config.output, pixelsY, pixelsX));
+        accumulator.reset(new AccumulatorT(roi, pixelsX, pixelsY, rawFile->data(), mode, sigmaAccuracy));
+    } else {
+        accumulator.reset(new AccumulatorT(roi, pixelsX, pixelsY, mode, sigmaAccuracy));
+    }
+
+    typename PointView<double>::ColumnMapT map{{0, 1, 2, -1, -1, -1}};
+    if(config.columns.size()>=5) map = {{0, 1, 2, 3, 4, -1}};
+    auto reader = open_localizations(config.input, config.columns);
+
+    ChunkQueue<arma::mat> queue(config.queueDepth);
+    std::exception_ptr readError;
+    std::thread producer([&]{
+        try {
+            arma::mat chunk;
+            while(reader->read(chunk, config.chunkRows) && queue.push(std::move(chunk))) { }
+        } catch(...) {
+            readError = std::current_exception();
+        }
+        queue.close();
+    });
+
+    using ClockT = std::chrono::steady_clock;
+    auto start = ClockT::now();
+    double waitSeconds = 0;
+    std::size_t rendered = 0;
+    try {
+        arma::mat chunk;
+        for(;;) {
+            auto waitStart = ClockT::now();
+            if(!queue.pop(chunk)) break;
+            waitSeconds += std::chrono::duration<double>(ClockT::now()-waitStart).count();
+            PointView<double> view(chunk, map);
+            if(config.sigma>0) view.set_constant(PointField::SigmaX, config.sigma)
+                                   .set_constant(PointField::SigmaY, config.sigma);
+            accumulator->add(view);
+            rendered += chunk.n_rows;
+        }
+    } catch(...) {
+        queue.close();
+        producer.join();
+        throw;
+    }
+    producer.join();
+    if(readError) std::rethrow_exception(readError);
+
+    if(raw) rawFile->close();
+    else write_tiff(config.output, accumulator->get_image(), config.bigTiff);
+    double seconds = std::chrono::duration<double>(ClockT::now()-start).count();
+    std::cerr<<"Rendered "<<rendered<<" points in "<<accumulator->get_num_batches()<<" chunks to "<<config.output
+             <<" ("<<pixelsY<<"x"<<pixelsX<<") in "<<seconds<<"s, waiting "<<waitSeconds<<"s on input\n";
+}
+
+int main(int argc, const char *argv[])
+{
+    Config config;
+    for(int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        if(i+1>=argc) { std::cerr<<"Missing value for "<<arg<<"\n"; return EXIT_FAILURE; }
+        const char *val = argv[++i];
+        if(arg=="--input") config.input = val;
+        else if(arg=="--output") config.output = val;
+        else if(arg=="--convert") config.convert = val;
+        else if(arg=="--roi") config.roi = parse_list(val);
+        else if(arg=="--pixels") config.pixels = parse_list(val);
+        else if(arg=="--sigma-accuracy") config.sigmaAccuracy = std::stod(val);
+        else if(arg=="--sigma") config.sigma = std::stod(val);
+        else if(arg=="--chunk-rows") config.chunkRows = std::max(1., std::stod(val));
+        else if(arg=="--queue-depth") config.queueDepth = std::max(1, std::stoi(val));
+        else if(arg=="--threads") config.threads = std::max(0, std::stoi(val));
+        else if(arg=="--bigtiff") config.bigTiff = std::stoi(val)!=0;
+        else if(arg=="--columns") {
+            config.columns.clear();
+            for(auto c: parse_list(val)) config.columns.push_back(static_cast<std::size_t>(c));
+        }
+        else if(arg=="--mode") {
+            std::string m = val;
+            if(m=="hist") config.gauss = false;
+            else if(m!="gauss") { std::cerr<<"Unknown mode "<<m<<"\n"; return EXIT_FAILURE; }
+        }
+        else if(arg=="--precision") {
+            std::string p = val;
+            if(p=="double") config.single = false;
+            else if(p!="float") { std::cerr<<"Unknown precision "<<p<<"\n"; return EXIT_FAILURE; }
+        }
+        else { std::cerr<<"Unknown argument "<<arg<<"\n"; return EXIT_FAILURE; }
+    }
+    if(config.input.empty()) { std::cerr<<"Missing --input\n"; return EXIT_FAILURE; }
+    if(config.columns.size()!=3 && config.columns.size()!=5) {
+        std::cerr<<"--columns needs 3 columns [I X Y] or 5 columns [I X Y sigmaX sigmaY]\n";
+        return EXIT_FAILURE;
+    }
+    try {
+        if(!config.convert.empty()) {
+            auto reader = open_localizations(config.input, config.columns);
+            std::size_t rows = write_srl(config.convert, *reader, config.chunkRows, config.single);
+            std::cerr<<"Wrote "<<rows<<" rows to "<<config.convert<<"\n";
+            return EXIT_SUCCESS;
+        }
+        if(config.output.empty() || config.roi.size()!=4 || config.pixels.size()!=2) {
+            std::cerr<<"Rendering needs --output, --roi xmin,xmax,ymin,ymax and --pixels X,Y\n";
+            return EXIT_FAILURE;
+        }
+        if(config.gauss && config.columns.size()<5 && !(config.sigma>0)) {
+            std::cerr<<"Gauss mode needs sigmaX and sigmaY --columns or a constant --sigma\n";
+            return EXIT_FAILURE;
+        }
+        RenderOptions options;
+        options.threads = config.threads;
+        RenderOptionsScope scope(options);
+        if(config.single) render<float>(config);
+        else render<double>(config);
+    } catch(std::exception &err) {
+        std::cerr<<"srrender: "<<err.what()<<"\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
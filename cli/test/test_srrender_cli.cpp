@@ -0,0 +1,215 @@
+#include "SRRender/SRRender.h"
+#include "LocalizationReader.h"
+#include "ImageWriter.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace arma;
+using namespace std;
+using namespace srrender;
+using namespace srrender::cli;
+
+void checkClose(const mat &a, const mat &b, double tol, const char *name)
+{
+    if(a.n_rows!=b.n_rows || a.n_cols!=b.n_cols)
+        throw SRRenderError("TestFailure", string(name)+" size mismatch");
+    double err = a.n_elem ? abs(a-b).max() : 0;
+    if(err>tol) throw SRRenderError("TestFailure", string(name)+" max error: "+to_string(err));
+}
+
+/* Throw a TestFailure with message failure unless func() throws an SRRenderError */
+template<class FuncT>
+void expect_throws(FuncT func, const char *failure)
+{
+    try { func(); }
+    catch(SRRenderError &) { return; }
+    throw SRRenderError("TestFailure", failure);
+}
+
+void writeFile(const string &path, const string &text)
+{
+    ofstream out(path);
+    out<<text;
+}
+
+/* Every remaining row of reader, read in chunks of chunkRows */
+mat readAll(LocalizationReader &reader, size_t chunkRows)
+{
+    vector<mat> chunks;
+    mat chunk;
+    size_t rows = 0;
+    while(reader.read(chunk, chunkRows)) {
+        if(chunk.n_rows>chunkRows) throw SRRenderError("TestFailure", "Reader returned too many rows");
+        chunks.push_back(chunk);
+        rows += chunk.n_rows;
+    }
+    mat all(rows, reader.get_columns().size());
+    size_t n = 0;
+    for(auto &c: chunks) for(uword r=0; r<c.n_rows; r++, n++) for(uword k=0; k<c.n_cols; k++) all(n,k) = c(r,k);
+    return all;
+}
+
+void testCSV()
+{
+    const char *path = "test_srrender_cli.csv";
+    writeFile(path, "# localizations\n"
+                    "\n"
+                    "I, X, Y\n"
+                    "1, 2.5, 3\n"
+                    "# comment between rows\n"
+                    "4\t5 6\n"
+                    "7,8,9\n");
+    mat expected = {{3., 1.}, {6., 4.}, {9., 7.}};
+    for(size_t chunkRows: {1, 2, 16}) {
+        CSVReader reader(path, {2, 0});
+        checkClose(readAll(reader, chunkRows), expected, 0, "CSVReader");
+        if(reader.get_rows_read()!=3) throw SRRenderError("TestFailure", "CSVReader row count");
+    }
+
+    //Only the first non-comment line may be a header, even within the first chunk
+    writeFile(path, "I,X,Y\n1,2,3\nx,5,6\n");
+    expect_throws([&]{
+        CSVReader reader(path, {0, 1, 2});
+        readAll(reader, 16);
+    }, "CSVReader skipped a malformed row after the header");
+
+    writeFile(path, "1,2,3\n4,5\n");
+    expect_throws([&]{
+        CSVReader reader(path, {0, 2});
+        readAll(reader, 16);
+    }, "CSVReader accepted a row with a missing column");
+    remove(path);
+}
+
+void testSRL()
+{
+    const char *csvPath = "test_srrender_cli_srl.csv";
+    const char *srlPath = "test_srrender_cli.srl";
+    string text = "I,X,Y,sigma\n";
+    mat expected(11,4);
+    for(int n=0; n<11; n++) {
+        for(int c=0; c<4; c++) expected(n,c) = n*4+c+0.25;
+        text += to_string(expected(n,0))+","+to_string(expected(n,1))+","+to_string(expected(n,2))+","+
+                to_string(expected(n,3))+"\n";
+    }
+    writeFile(csvPath, text);
+    for(bool singlePrecision: {true, false}) {
+        CSVReader csv(csvPath, {0, 1, 2, 3});
+        if(write_srl(srlPath, csv, 3, singlePrecision)!=11) throw SRRenderError("TestFailure", "write_srl row count");
+        auto reader = open_localizations(srlPath, {3, 1});
+        SRLReader *srl = dynamic_cast<SRLReader*>(reader.get());
+        if(!srl || srl->get_num_columns()!=4) throw SRRenderError("TestFailure", "open_localizations SRL header");
+        mat selected(11,2);
+        for(int n=0; n<11; n++) {
+            selected(n,0) = expected(n,3);
+            selected(n,1) = expected(n,1);
+        }
+        checkClose(readAll(*reader, 2), selected, 0, "SRL round trip");
+    }
+    writeFile(srlPath, "SRLOC");
+    expect_throws([&]{ SRLReader reader(srlPath, {0}); }, "SRLReader accepted a truncated header");
+    remove(csvPath);
+    remove(srlPath);
+}
+
+/* A minimal little-endian TIFF and BigTIFF reader for the single IFD write_tiff produces */
+class TiffFile {
+public:
+    explicit TiffFile(const string &path)
+    {
+        ifstream in(path, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        if(bytes.size()<8 || bytes[0]!='I' || bytes[1]!='I') throw SRRenderError("TestFailure", "TIFF byte order");
+        uint16_t version = get<uint16_t>(2);
+        if(version==43) {
+            if(get<uint16_t>(4)!=8 || get<uint16_t>(6)!=0) throw SRRenderError("TestFailure", "BigTIFF header");
+            bigTiff = true;
+            ifd = get<uint64_t>(8);
+        } else if(version==42) {
+            ifd = get<uint32_t>(4);
+        } else {
+            throw SRRenderError("TestFailure", "TIFF version");
+        }
+    }
+
+    template<class T>
+    T get(uint64_t offset) const
+    {
+        if(offset+sizeof(T)>bytes.size()) throw SRRenderError("TestFailure", "TIFF offset out of range");
+        T value;
+        memcpy(&value, bytes.data()+offset, sizeof(T));
+        return value;
+    }
+
+    /* The values of tag, which must be present */
+    vector<uint64_t> tag(uint16_t id) const
+    {
+        uint64_t nEntries = bigTiff ? get<uint64_t>(ifd) : get<uint16_t>(ifd);
+        uint64_t entrySize = bigTiff ? 20 : 12;
+        uint64_t inlineBytes = bigTiff ? 8 : 4;
+        for(uint64_t e=0; e<nEntries; e++) {
+            uint64_t entry = ifd + (bigTiff ? 8 : 2) + e*entrySize;
+            if(get<uint16_t>(entry)!=id) continue;
+            uint16_t type = get<uint16_t>(entry+2);
+            uint64_t count = bigTiff ? get<uint64_t>(entry+4) : get<uint32_t>(entry+4);
+            uint64_t field = entry + (bigTiff ? 12 : 8);
+            uint64_t size = type==3 ? 2 : type==4 ? 4 : 8; //Short, Long, Long8
+            uint64_t data = count*size<=inlineBytes ? field : (bigTiff ? get<uint64_t>(field) : get<uint32_t>(field));
+            vector<uint64_t> values(count);
+            for(uint64_t k=0; k<count; k++) {
+                uint64_t at = data+k*size;
+                values[k] = size==2 ? get<uint16_t>(at) : size==4 ? get<uint32_t>(at) : get<uint64_t>(at);
+            }
+            return values;
+        }
+        throw SRRenderError("TestFailure", "TIFF tag "+to_string(id)+" missing");
+    }
+
+    bool bigTiff = false;
+    uint64_t ifd = 0;
+
+private:
+    vector<char> bytes;
+};
+
+template<class FloatT>
+void testTiff(bool bigTiff)
+{
+    const char *path = "test_srrender_cli.tif";
+    Mat<FloatT> im(5,7);
+    for(uword n=0; n<im.n_elem; n++) im(n) = static_cast<FloatT>(n)/4;
+    write_tiff(path, im, bigTiff);
+    TiffFile tiff(path);
+    if(tiff.bigTiff!=bigTiff) throw SRRenderError("TestFailure", "write_tiff format");
+    if(tiff.tag(256)!=vector<uint64_t>{7} || tiff.tag(257)!=vector<uint64_t>{5})
+        throw SRRenderError("TestFailure", "write_tiff image size");
+    if(tiff.tag(258)!=vector<uint64_t>{8*sizeof(FloatT)} || tiff.tag(339)!=vector<uint64_t>{3})
+        throw SRRenderError("TestFailure", "write_tiff sample format");
+    vector<uint64_t> offsets = tiff.tag(273), counts = tiff.tag(279);
+    uint64_t rowsPerStrip = tiff.tag(278).at(0);
+    if(offsets.size()!=counts.size()) throw SRRenderError("TestFailure", "write_tiff strips");
+    Mat<FloatT> read(5,7);
+    uword y = 0;
+    for(size_t s=0; s<offsets.size(); s++) {
+        if(counts[s]%(7*sizeof(FloatT)) || counts[s]/(7*sizeof(FloatT))>rowsPerStrip)
+            throw SRRenderError("TestFailure", "write_tiff strip size");
+        for(uint64_t r=0; r<counts[s]/(7*sizeof(FloatT)); r++, y++) //TIFF is row-major
+            for(uword x=0; x<7; x++) read(y,x) = tiff.get<FloatT>(offsets[s]+(r*7+x)*sizeof(FloatT));
+    }
+    if(y!=5) throw SRRenderError("TestFailure", "write_tiff strip rows");
+    checkClose(conv_to<mat>::from(read), conv_to<mat>::from(im), 0, "write_tiff");
+    remove(path);
+}
+
+int main(){
+    testCSV();
+    testSRL();
+    testTiff<float>(false);
+    testTiff<float>(true);
+    testTiff<double>(false);
+    testTiff<double>(true);
+    return 0;
+}
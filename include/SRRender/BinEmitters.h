@@ -0,0 +1,65 @@
+/** @file BinEmitters.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Parallel binning of emitters shared by the renderers.
+ */
+
+#ifndef SRRENDER_BINEMITTERS_H
+#define SRRENDER_BINEMITTERS_H
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "SRRender/RenderOptions.h"
+
+namespace srrender {
+namespace binning {
+
+/* Counting sort of N emitters into nBins bins.
+ *
+ * binsOf(n, add) calls add(bin) once for each bin emitter n belongs to, which may be none or several.  Emitters are
+ * counted and scattered in contiguous chunks so the binning runs in parallel, while the emitters within each bin
+ * are always in ascending order, so renders using the bins do not depend on the number of threads.
+ *
+ * [out] binOffsets - size nBins+1.  Bin b holds binEmitters[binOffsets[b] ... binOffsets[b+1]-1]
+ * [out] binEmitters - emitter indexes for all bins.
+ */
+template<class IdxT, class BinsOfFuncT>
+void bin_emitters(IdxT N, std::size_t nBins, BinsOfFuncT binsOf,
+                  std::vector<std::size_t> &binOffsets, std::vector<IdxT> &binEmitters)
+{
+    IdxT nChunks = std::max<IdxT>(1, std::min<IdxT>(N, RenderOptionsScope::threads()));
+    IdxT chunkSize = (N+nChunks-1)/nChunks;
+    //binPos[b*nChunks+c] counts then offsets the emitters of chunk c in bin b.
+    std::vector<std::size_t> binPos(nBins*nChunks,0);
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(IdxT c=0; c<nChunks; c++) {
+            IdxT nEnd = std::min(N, (c+1)*chunkSize);
+            for(IdxT n=c*chunkSize; n<nEnd; n++) binsOf(n, [&](std::size_t b) { binPos[b*nChunks+c]++; });
+        }
+    });
+    binOffsets.resize(nBins+1);
+    std::size_t total = 0;
+    for(std::size_t b=0; b<binPos.size(); b++) {
+        if(b%nChunks == 0) binOffsets[b/nChunks] = total;
+        std::size_t count = binPos[b];
+        binPos[b] = total;
+        total += count;
+    }
+    binOffsets[nBins] = total;
+    binEmitters.resize(total);
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(IdxT c=0; c<nChunks; c++) {
+            IdxT nEnd = std::min(N, (c+1)*chunkSize);
+            for(IdxT n=c*chunkSize; n<nEnd; n++) binsOf(n, [&](std::size_t b) { binEmitters[binPos[b*nChunks+c]++] = n; });
+        }
+    });
+}
+
+} /* namespace srrender::binning */
+} /* namespace srrender */
+
+#endif /* SRRENDER_BINEMITTERS_H */
@@ -0,0 +1,82 @@
+/** @file CostModel.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration for CostModel.
+ *
+ * Cost estimates for choosing between the SRRender2D render engines
+ */
+
+#ifndef SRRENDER_COSTMODEL_H
+#define SRRENDER_COSTMODEL_H
+
+#include <cstddef>
+#include <string>
+
+namespace srrender {
+
+/**
+ * A linear cost model for the Single, Parallel and Tiled render engines, used by Engine::Auto.
+ *
+ * For N points with mean stencil sizes sx x sy pixels rendered by T threads into an image of B bytes,
+ * costs in nanoseconds are estimated as
+ *      work     = N*(point + stencil*(sx+sy) + splat*sx*sy)
+ *      Single   = work + mem*B
+ *      Parallel = work/T + mem*B*(2T+1) + parallel
+ *      Tiled    = (2*bin*N + N*overlap*(point + stencil*(sx+sy)) + N*splat*sx*sy)/T + mem*B + parallel
+ *      FFT      = G*(fft*F/T + mem*B*(s+1)) + N*point + parallel
+ * where overlap is the mean number of tiles a stencil touches, each of which recomputes its stencils, and T is
+ * limited to the number of tiles for Tiled.  The FFT engine renders each of G distinct sigmas with column FFTs over
+ * F = sum(length*log2(length)) elements, with histograms of s sub-pixels per pixel; it is only estimated if G>0.
+ * Engine::Auto compares only the exact Single, Parallel and Tiled engines; the FFT estimate is for comparisons.
+ * Memory terms are not divided by T since zeroing and summing the per-thread images is limited by the shared memory
+ * bandwidth, which is why the Parallel engine loses on large images.  Hist renders have sx=sy=1 and, like
+ * StencilTable renders, no stencil evaluations.
+ *
+ * calibrate() measures the coefficients on the current machine.  Models are saved to and loaded from a text file
+ * of "name value" lines.  The global model used by Engine::Auto is loaded from the file named by the
+ * SRRENDER_COST_MODEL environment variable on first use, or has the default coefficients.
+ */
+class CostModel {
+public:
+    struct Problem {
+        std::size_t nPoints = 0;
+        std::size_t pixelsX = 0;
+        std::size_t pixelsY = 0;
+        double stencilX = 1; //Mean stencil size in pixels along X
+        double stencilY = 1; //Mean stencil size in pixels along Y
+        bool computeStencils = false; //False for histograms and table lookups
+        std::size_t bytesPerPixel = sizeof(float);
+        std::size_t tileSize = 256;
+        int threads = 1;
+        std::size_t sigmaGroups = 0; //Distinct sigmas for the FFT engine, or 0 if it cannot be used
+        std::size_t subpixels = 4; //FFT engine histogram bins per pixel
+    };
+    struct Costs {
+        double single;
+        double parallel;
+        double tiled;
+        double fft;
+    };
+
+    double pointNs = 10;        //Per-point overhead
+    double stencilNs = 6;       //Per 1D stencil value computed
+    double splatNs = 1;         //Per pixel added into an image
+    double binNs = 5;           //Per point and pass binning into tiles
+    double memNsPerByte = 0.1;  //Zeroing or summing image memory
+    double parallelNs = 5000;   //Starting a parallel region
+    double fftNs = 2;           //Per FFT element and radix-2 stage
+
+    Costs estimate(const Problem &problem) const;
+    static double fft_elements(const Problem &problem);
+
+    static CostModel calibrate();
+    void save(const std::string &path) const;
+    static CostModel load(const std::string &path);
+
+    static CostModel global();
+    static void set_global(const CostModel &model);
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_COSTMODEL_H */
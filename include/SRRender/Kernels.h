@@ -0,0 +1,51 @@
+/** @file Kernels.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief Declarations for the SIMD rendering kernels and their runtime ISA dispatch.
+ *
+ * The kernels are implemented for each supported instruction set and the best one available on the running CPU
+ * is selected at runtime.  Every ISA gives bit-identical results to the scalar kernels: the vector kernels perform
+ * exactly the same IEEE operations in the same order as the scalar loops, without fused multiply-adds.
+ */
+
+#ifndef SRRENDER_KERNELS_H
+#define SRRENDER_KERNELS_H
+
+#include <cstddef>
+
+namespace srrender {
+namespace kernels {
+
+enum class ISA {Scalar, AVX2, AVX512};
+
+const char* isa_name(ISA isa);
+bool isa_supported(ISA isa);
+
+/** The ISA used by the kernels.  This is the best ISA supported by the CPU, which can be lowered by setting the
+ * environment variable SRRENDER_ISA to one of "scalar", "avx2", or "avx512".
+ */
+ISA active_isa();
+
+/** Rank-1 update of a column-major image block: im(y,x) += (I*xs[x]) * ys[y] for x<nx and y<ny.
+ * im points to the first pixel of the block and ld is the column stride of the image.
+ */
+template<class FloatT>
+void splat_rank1(FloatT *im, std::size_t ld, std::size_t nx, std::size_t ny, FloatT I, const FloatT *xs, const FloatT *ys);
+template<class FloatT>
+void splat_rank1(ISA isa, FloatT *im, std::size_t ld, std::size_t nx, std::size_t ny, FloatT I, const FloatT *xs, const FloatT *ys);
+
+/** out[i] = erf(x[i]) for i<n.  x and out may be the same array.
+ *
+ * Uses a piecewise degree 6 (float) or 9 (double) Taylor expansion of erf about the midpoints of 32 (float) or
+ * 64 (double) equal intervals over [0,4] (float) or [0,6] (double).  The maximum absolute error is a few units
+ * in the last place of FloatT.
+ */
+template<class FloatT>
+void erf_array(std::size_t n, const FloatT *x, FloatT *out);
+template<class FloatT>
+void erf_array(ISA isa, std::size_t n, const FloatT *x, FloatT *out);
+
+} /* namespace srrender::kernels */
+} /* namespace srrender */
+
+#endif /* SRRENDER_KERNELS_H */
@@ -0,0 +1,104 @@
+/** @file PointView.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline functions for PointView.
+ *
+ * Non-owning views of emitter localizations for SRRender
+ */
+
+#ifndef SRRENDER_POINTVIEW_H
+#define SRRENDER_POINTVIEW_H
+
+#include <array>
+#include <cstddef>
+#include <armadillo>
+
+namespace srrender {
+
+/** The per-point properties used by the renderers */
+enum class PointField {I=0, X=1, Y=2, SigmaX=3, SigmaY=4, Frame=5};
+
+/**
+ * A lightweight non-owning view of N emitter localizations stored in existing memory.
+ *
+ * Each field is either a strided column of PointFloatT values, or a constant shared by all points.  This allows
+ * rendering directly from a points matrix in any column order, a struct-of-arrays or array-of-structs from a
+ * fitter, or points of a different precision than the image, all without copying.  The default field layout
+ * matches the SRRender2D points format [I X Y sigmaX sigmaY Frame].
+ *
+ * The viewed memory must outlive the view and must not be modified while rendering.
+ */
+template<class PointFloatT>
+class PointView {
+public:
+    static const int NumFields = 6;
+    using ColumnMapT = std::array<int,NumFields>; //Column index for each PointField or -1 if absent
+    using PointsT = arma::Mat<PointFloatT>;
+
+    /** A view of nPoints points with no fields set. */
+    explicit PointView(std::size_t nPoints) : num_points(nPoints) {}
+
+    /** A view of a points matrix in the standard layout.  Fields without a column in points are not set. */
+    explicit PointView(const PointsT &points) : PointView(points, ColumnMapT{{0,1,2,3,4,5}}) {}
+
+    /** A view of a points matrix with the column for each PointField given by columns, or -1 if not present. */
+    explicit PointView(const PointsT &points, const ColumnMapT &columns) : num_points(points.n_rows)
+    {
+        for(int f=0; f<NumFields; f++)
+            if(columns[f]>=0 && static_cast<arma::uword>(columns[f])<points.n_cols)
+                set_column(static_cast<PointField>(f), points.colptr(columns[f]));
+    }
+
+    /** Views of temporary matrices would dangle once the matrix is destroyed. */
+    explicit PointView(PointsT &&points) = delete;
+    explicit PointView(PointsT &&points, const ColumnMapT &columns) = delete;
+
+    /** Set field to the values data[n*stride] for n<n_points(). */
+    PointView& set_column(PointField field, const PointFloatT *data, std::size_t stride=1)
+    {
+        Column &c = fields[static_cast<int>(field)];
+        c.data = data;
+        c.stride = stride;
+        c.present = data!=nullptr;
+        return *this;
+    }
+
+    /** Set field to the same value for all points, e.g., a constant sigma or intensity. */
+    PointView& set_constant(PointField field, PointFloatT value)
+    {
+        Column &c = fields[static_cast<int>(field)];
+        c.data = nullptr;
+        c.value = value;
+        c.present = true;
+        return *this;
+    }
+
+    std::size_t n_points() const { return num_points; }
+    bool has(PointField field) const { return fields[static_cast<int>(field)].present; }
+
+    PointFloatT get(PointField field, std::size_t n) const
+    {
+        const Column &c = fields[static_cast<int>(field)];
+        return c.data ? c.data[n*c.stride] : c.value;
+    }
+    PointFloatT I(std::size_t n) const { return get(PointField::I, n); }
+    PointFloatT X(std::size_t n) const { return get(PointField::X, n); }
+    PointFloatT Y(std::size_t n) const { return get(PointField::Y, n); }
+    PointFloatT sigmaX(std::size_t n) const { return get(PointField::SigmaX, n); }
+    PointFloatT sigmaY(std::size_t n) const { return get(PointField::SigmaY, n); }
+    PointFloatT frame(std::size_t n) const { return get(PointField::Frame, n); }
+
+private:
+    struct Column {
+        const PointFloatT *data = nullptr;
+        std::size_t stride = 0;
+        PointFloatT value = 0;
+        bool present = false;
+    };
+    std::size_t num_points;
+    std::array<Column,NumFields> fields;
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_POINTVIEW_H */
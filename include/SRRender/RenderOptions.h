@@ -0,0 +1,78 @@
+/** @file RenderOptions.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline functions for RenderOptions.
+ *
+ * Per-call threading and memory placement options for SRRender renders
+ */
+
+#ifndef SRRENDER_RENDEROPTIONS_H
+#define SRRENDER_RENDEROPTIONS_H
+
+#include <omp.h>
+
+namespace srrender {
+
+/**
+ * Threading options for the renders made while a RenderOptionsScope is active.
+ *
+ * Options apply only to the render threads, so the process-wide OpenMP settings seen by other libraries are left
+ * alone.  Renders outside any scope use the OpenMP defaults.
+ *
+ * On multi-socket machines, Affinity::Spread with firstTouch places threads across the sockets and has each thread
+ * zero the parts of the output image and scratch buffers it will write, so the pages are allocated on the memory
+ * node of the thread that uses them and repeated renders into the same image keep that placement.
+ */
+struct RenderOptions {
+    /** OpenMP thread binding (proc_bind) for render threads.  Default uses OMP_PROC_BIND. */
+    enum class Affinity {Default, Close, Spread};
+
+    int threads = 0;                       //Threads for each parallel region, or 0 for omp_get_max_threads()
+    Affinity affinity = Affinity::Default;
+    bool firstTouch = false;               //Threads first-touch the image regions they will write
+};
+
+/**
+ * Applies RenderOptions to every render started on the constructing thread until the scope is destroyed.
+ * Scopes nest, the innermost scope's options are used.
+ */
+class RenderOptionsScope {
+public:
+    explicit RenderOptionsScope(const RenderOptions &options);
+    ~RenderOptionsScope();
+    RenderOptionsScope(const RenderOptionsScope&) = delete;
+    RenderOptionsScope& operator=(const RenderOptionsScope&) = delete;
+
+    /** The options of the innermost active scope on this thread, or the default options */
+    static const RenderOptions& active();
+    /** The number of threads render parallel regions started on this thread will request */
+    static int threads();
+private:
+    RenderOptions options;
+    const RenderOptions *previous;
+};
+
+/** Run body() on each thread of an OpenMP parallel region with the active RenderOptions.  Worksharing constructs
+ * in body bind to this region. */
+template<class BodyT>
+void parallel_region(BodyT &&body)
+{
+    int threads = RenderOptionsScope::threads();
+    switch(RenderOptionsScope::active().affinity) {
+        case RenderOptions::Affinity::Close:
+            #pragma omp parallel num_threads(threads) proc_bind(close)
+            body();
+            break;
+        case RenderOptions::Affinity::Spread:
+            #pragma omp parallel num_threads(threads) proc_bind(spread)
+            body();
+            break;
+        default:
+            #pragma omp parallel num_threads(threads)
+            body();
+    }
+}
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_RENDEROPTIONS_H */
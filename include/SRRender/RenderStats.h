@@ -0,0 +1,71 @@
+/** @file RenderStats.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline functions for RenderStats.
+ *
+ * Optional per-phase instrumentation of SRRender renders
+ */
+
+#ifndef SRRENDER_RENDERSTATS_H
+#define SRRENDER_RENDERSTATS_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace srrender {
+
+/**
+ * Statistics accumulated over the renders made while a RenderStatsScope is active.
+ *
+ * Instrumentation is compiled in only when SRRENDER_STATS is defined (CMake option OPT_STATS).  Otherwise the
+ * recording calls in the render engines are empty inline functions, there is no runtime cost, and the stats
+ * stay zero.  When compiled in, renders outside any scope only pay for one thread-local pointer check.
+ *
+ * Phase times marked "thread time" are summed over all threads, so they can exceed the wall time of the render.
+ */
+struct RenderStats {
+#ifdef SRRENDER_STATS
+    static const bool Enabled = true;
+#else
+    static const bool Enabled = false;
+#endif
+    using StatsT = std::map<std::string,double>;
+
+    std::size_t renders = 0;        //Render engine calls
+    int threads = 0;                //Most threads used by any render
+    double totalSeconds = 0;        //Wall time in the render engines
+    double allocSeconds = 0;        //Thread time allocating and zeroing per-thread images, tiles and stencils
+    double binSeconds = 0;          //Wall time binning emitters into tiles or frames
+    double stencilSeconds = 0;      //Thread time computing or looking up stencils
+    double splatSeconds = 0;        //Thread time adding stencils into images
+    double reduceSeconds = 0;       //Wall time summing per-thread images into the output
+    std::size_t pointsRendered = 0; //Points overlapping the image
+    std::size_t pointsClipped = 0;  //Points entirely outside the image or with non-finite positions
+    std::size_t stencilPixels = 0;  //Pixel values written by splats
+    std::size_t scratchBytes = 0;   //Bytes of temporary images, stencils and bins allocated
+
+    void reset() { *this = RenderStats(); }
+    StatsT get_stats() const;
+};
+
+/**
+ * Collects RenderStats for every render started on the constructing thread until the scope is destroyed.
+ * Scopes nest, the innermost scope receives the stats.
+ */
+class RenderStatsScope {
+public:
+    explicit RenderStatsScope(RenderStats &stats);
+    ~RenderStatsScope();
+    RenderStatsScope(const RenderStatsScope&) = delete;
+    RenderStatsScope& operator=(const RenderStatsScope&) = delete;
+
+    /** The stats of the innermost active scope on this thread, or nullptr */
+    static RenderStats* active();
+private:
+    RenderStats *previous;
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_RENDERSTATS_H */
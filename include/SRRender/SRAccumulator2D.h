@@ -0,0 +1,79 @@
+/** @file SRAccumulator2D.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline and templated functions for SRAccumulator2D.
+ *
+ * Incremental rendering of SR emitter localizations arriving in batches
+ */
+
+#ifndef SRRENDER_SRACCUMULATOR2D_H
+#define SRRENDER_SRACCUMULATOR2D_H
+
+#include <memory>
+#include "SRRender/SRRender.h"
+
+namespace srrender {
+
+/**
+ * A stateful renderer that accumulates batches of localizations into a single image.
+ *
+ * The accumulator owns the ROI, the image geometry and the accumulation image.  Each call to add() renders only
+ * the new points, so refreshing a live preview costs O(new points) instead of re-rendering every point so far.
+ * Points use the SRRender2D formats: [I X Y] in Hist mode and [I X Y sigmaX sigmaY] in Gauss mode, or may be given
+ * as a PointView of float or double points in any layout.
+ *
+ * Large batches are rendered in parallel over image tiles directly into the accumulation image, small batches
+ * serially.  add(), reset() and snapshot() must not be called concurrently on the same object.
+ */
+template<class FloatT=float, class IdxT=uint32_t>
+class SRAccumulator2D {
+public:
+    using RenderT = SRRender2D<FloatT,IdxT>;
+    using VecT = typename RenderT::VecT;
+    using ImageT = typename RenderT::ImageT;
+    using EmitterVecT = typename RenderT::EmitterVecT;
+    using StencilTableT = typename RenderT::StencilTableT;
+    enum class Mode {Hist, Gauss};
+    static const IdxT ParallelBatchSize; //Batches with at least this many points are rendered in parallel
+
+    SRAccumulator2D(const VecT &roi, IdxT pixelsX, IdxT pixelsY, Mode mode=Mode::Gauss,
+                    FloatT sigmaAccuracy=RenderT::DefaultSigmaAccuracy);
+    /** Accumulate into caller-owned memory of pixelsY x pixelsX column-major values, e.g., a memory-mapped file.
+     * The memory is zeroed and must outlive the accumulator. */
+    SRAccumulator2D(const VecT &roi, IdxT pixelsX, IdxT pixelsY, FloatT *imageMemory, Mode mode=Mode::Gauss,
+                    FloatT sigmaAccuracy=RenderT::DefaultSigmaAccuracy);
+
+    void add(const EmitterVecT &points);
+    template<class PointFloatT>
+    void add(const PointView<PointFloatT> &points);
+    void reset();
+    ImageT snapshot() const { return image; }
+    const ImageT& get_image() const { return image; }
+
+    const VecT& get_roi() const { return roi; }
+    IdxT get_pixels_x() const { return static_cast<IdxT>(image.n_cols); }
+    IdxT get_pixels_y() const { return static_cast<IdxT>(image.n_rows); }
+    Mode get_mode() const { return mode; }
+    FloatT get_sigma_accuracy() const { return table ? table->get_sigma_accuracy() : sigma_accuracy; }
+    std::size_t get_num_points() const { return num_points; } //Points added since construction or reset()
+    std::size_t get_num_batches() const { return num_batches; } //Batches added since construction or reset()
+
+    /** Render Gaussians with precomputed stencils from table, or exact stencils if table is null.
+     * The table's sigmaAccuracy replaces the accumulator's. */
+    void set_stencil_table(std::shared_ptr<const StencilTableT> table_) { table = table_; }
+
+private:
+    VecT roi;
+    Mode mode;
+    FloatT sigma_accuracy;
+    std::shared_ptr<const StencilTableT> table;
+    ImageT image;
+    std::size_t num_points = 0;
+    std::size_t num_batches = 0;
+
+    void check_geometry() const;
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_SRACCUMULATOR2D_H */
@@ -0,0 +1,86 @@
+/** @file SRAsyncRender2D.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline and templated functions for SRAsyncRender2D.
+ *
+ * Background rendering of SR emitter localizations with progressive previews
+ */
+
+#ifndef SRRENDER_SRASYNCRENDER2D_H
+#define SRRENDER_SRASYNCRENDER2D_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "SRRender/SRAccumulator2D.h"
+
+namespace srrender {
+
+/**
+ * A render running on a background thread, which can be polled, previewed and cancelled.
+ *
+ * The constructor copies the points and returns immediately.  The background thread renders the points in a random
+ * order, in batches that start small and double in size, into an SRAccumulator2D.  snapshot() returns the image
+ * of the points rendered so far scaled up by the fraction not yet rendered, so the first preview is available after
+ * a few thousand points and converges to the full image.  Batches are rendered with the RenderOptions active when
+ * the render was started.
+ *
+ * The finished image matches SRRender2D renders of the same points up to floating point summation order.
+ * progress(), done(), snapshot() and cancel() may be called from any thread at any time.  wait() must not be
+ * called concurrently.  The destructor cancels the render and waits for the background thread.
+ */
+template<class FloatT=float, class IdxT=uint32_t>
+class SRAsyncRender2D {
+public:
+    using AccumulatorT = SRAccumulator2D<FloatT,IdxT>;
+    using RenderT = typename AccumulatorT::RenderT;
+    using VecT = typename RenderT::VecT;
+    using ImageT = typename RenderT::ImageT;
+    using EmitterVecT = typename RenderT::EmitterVecT;
+    using Mode = typename AccumulatorT::Mode;
+    static const IdxT FirstBatchSize; //Points in the first batch, i.e., before the first preview
+    static const IdxT MaxBatchSize; //Largest batch, which bounds how long snapshot() can wait for a batch to finish
+
+    SRAsyncRender2D(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, Mode mode=Mode::Gauss,
+                    FloatT sigmaAccuracy=RenderT::DefaultSigmaAccuracy, std::uint64_t seed=0);
+    ~SRAsyncRender2D();
+    SRAsyncRender2D(const SRAsyncRender2D&) = delete;
+    SRAsyncRender2D& operator=(const SRAsyncRender2D&) = delete;
+
+    /** Fraction of the points rendered so far, in [0,1] */
+    double progress() const;
+    /** True once the background thread has stopped, because it finished, was cancelled or failed */
+    bool done() const { return finished; }
+    bool cancelled() const { return cancel_requested && num_rendered<get_num_points(); }
+    /** Stop rendering after the current batch.  The image keeps the points already rendered. */
+    void cancel() { cancel_requested = true; }
+    /** Wait for the background thread to stop.  Rethrows any error the render raised. */
+    void wait();
+
+    /** The image of the points rendered so far, scaled by num_points/num_rendered to estimate the full image */
+    ImageT snapshot() const;
+
+    std::size_t get_num_points() const { return points.n_rows; }
+    std::size_t get_num_rendered() const { return num_rendered; }
+    const VecT& get_roi() const { return accumulator.get_roi(); }
+
+private:
+    EmitterVecT points;
+    AccumulatorT accumulator;
+    RenderOptions options;
+    std::uint64_t seed;
+    mutable std::mutex image_mutex; //Held while a batch is added to the accumulator
+    std::atomic<std::size_t> num_rendered;
+    std::atomic<bool> cancel_requested;
+    std::atomic<bool> finished;
+    std::exception_ptr error;
+    std::thread worker;
+
+    void run();
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_SRASYNCRENDER2D_H */
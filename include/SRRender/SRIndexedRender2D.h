@@ -0,0 +1,78 @@
+/** @file SRIndexedRender2D.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline and templated functions for SRIndexedRender2D.
+ *
+ * Repeated rendering of sub-regions of a large set of SR emitter localizations
+ */
+
+#ifndef SRRENDER_SRINDEXEDRENDER2D_H
+#define SRRENDER_SRINDEXEDRENDER2D_H
+
+#include <vector>
+#include "SRRender/SRRender.h"
+
+namespace srrender {
+
+/**
+ * A renderer that indexes a fixed set of points once for many renders of small ROIs, e.g., when panning and zooming.
+ *
+ * The points are copied into a uniform grid of square cells, sorted by cell with the cells of each grid column
+ * contiguous.  Each render visits only the cells overlapping the ROI, widened by the largest stencil reach, and
+ * renders those points with SRRender2D, so the cost scales with the points in view rather than all points.
+ * Images match SRRender2D renders of all the points up to floating point summation order.
+ *
+ * Points use the SRRender2D format [I X Y sigmaX sigmaY], where the sigmas are only needed for renderGauss, or may be
+ * given as a PointView of float or double points in any layout.  Points with non-finite X or Y are dropped.
+ * The render methods are const and may be called concurrently.
+ */
+template<class FloatT=float, class IdxT=uint32_t>
+class SRIndexedRender2D {
+public:
+    using RenderT = SRRender2D<FloatT,IdxT>;
+    using VecT = typename RenderT::VecT;
+    using ImageT = typename RenderT::ImageT;
+    using EmitterVecT = typename RenderT::EmitterVecT;
+    using Engine = typename RenderT::Engine;
+    static const IdxT DefaultPointsPerCell; //Mean number of points per cell used to choose the default cell size
+
+    /** Index points with square cells of edge cellSize in point units, or a size chosen from the point density
+     * if cellSize is 0. */
+    explicit SRIndexedRender2D(const EmitterVecT &points, FloatT cellSize=0);
+    template<class PointFloatT>
+    explicit SRIndexedRender2D(const PointView<PointFloatT> &points, FloatT cellSize=0);
+
+    void renderHist(const VecT &roi, ImageT &im, Engine engine=Engine::Auto) const;
+    void renderGauss(const VecT &roi, ImageT &im, FloatT sigmaAccuracy=RenderT::DefaultSigmaAccuracy,
+                     Engine engine=Engine::Auto) const;
+
+    /** Number of indexed points the render of im over roi would visit */
+    std::size_t count_visible(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy=0) const;
+
+    std::size_t get_num_points() const { return points.n_rows; }
+    bool has_sigma() const { return points.n_cols==5; }
+    FloatT get_cell_size() const { return cell_size; }
+    IdxT get_cells_x() const { return cells_x; }
+    IdxT get_cells_y() const { return cells_y; }
+
+private:
+    EmitterVecT points; //Points sorted by cell, with columns [I X Y] or [I X Y sigmaX sigmaY]
+    std::vector<std::size_t> cell_offsets; //Points of cell c=cx*cells_y+cy are rows [cell_offsets[c],cell_offsets[c+1])
+    FloatT xmin = 0;
+    FloatT ymin = 0;
+    FloatT cell_size = 1;
+    IdxT cells_x = 1;
+    IdxT cells_y = 1;
+    FloatT max_sigma_x = 0;
+    FloatT max_sigma_y = 0;
+
+    template<class PointFloatT>
+    void build(const PointView<PointFloatT> &view, FloatT cellSize);
+    void visible_runs(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy,
+                      std::vector<std::pair<std::size_t,std::size_t>> &runs) const;
+    void gather(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy, EmitterVecT &visible) const;
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_SRINDEXEDRENDER2D_H */
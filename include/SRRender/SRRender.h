@@ -11,11 +11,25 @@
 
 #include <BacktraceException/BacktraceException.h>
 #include <armadillo>
+#include <complex>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+#include "SRRender/CostModel.h"
+#include "SRRender/PointView.h"
+#include "SRRender/RenderOptions.h"
+#include "SRRender/RenderStats.h"
+#include "SRRender/StencilTable.h"
 
 namespace srrender {
 
 using SRRenderError = backtrace_exception::BacktraceException;
 
+template<class FloatT, class IdxT> class SRAccumulator2D;
+template<class FloatT, class IdxT> class SRRender3D;
+template<class FloatT, class IdxT> class SRIndexedRender2D;
+
 /**
  * 
  * Points format.  Row-oriented each row is a point, each column is a property
@@ -27,6 +41,55 @@ using SRRenderError = backtrace_exception::BacktraceException;
  * The 'size' parameter gives the size of the entire field of view to be rendered in units 
  * corresponding to the points format vectors.
  * 
+ * The Tiled renderers split the output image into square tiles of tileSize pixels.  Emitters are binned into
+ * every tile their stencil overlaps and each thread renders whole tiles directly into the output image, so no
+ * per-thread image copies or reduction pass are needed.  Results do not depend on the number of threads.
+ *
+ * Each renderer also accepts a PointView, which renders without copying from points in any column layout, strided
+ * or array-of-structs memory, with constant fields such as a fixed sigma, and in either float or double precision
+ * independent of the image precision.  Missing required fields throw an SRRenderError.
+ *
+ * The MovieWindowed renderers make sliding-window movies: output frame k is the sum of the input frames
+ * [k*stride, k*stride+window).  Each emitter is rendered once and the windows are built from running sums, so the
+ * cost does not depend on the window length.  Emitters in input frames past the last window are ignored.
+ *
+ * The MovieStream renderers make movies too long to hold in memory.  Points must be sorted by frame.  Frames are
+ * rendered framesInFlight at a time (default one per render thread) and each finished frame is passed to a
+ * FrameSinkT, e.g., a file writer or video encoder, in frame order.  The sink runs on a background thread while the
+ * next frames render, and is called one frame at a time, so memory holds at most 2*framesInFlight frames whatever
+ * the movie length.  The image passed to the sink is reused once it returns.  Frames with no points are passed as
+ * zero images, and an exception thrown by the sink stops the render and is rethrown to the caller.
+ *
+ * The Channels renderers make multi-channel images in a single pass over the points, reading the channel index of
+ * each point from the Frame field (column 6).  Without weights, slice c of the output is the image of channel c.
+ * With a weights matrix of one row per channel and one column per output slice, each point is added to every
+ * slice k with intensity I*weights(channel,k), e.g., with a 3 column matrix of channel colors to make an RGB image.
+ * Each stencil is computed once and added to all the slices the channel contributes to, and threads render whole
+ * image tiles of every slice, so there are no per-thread images or reduction.
+ *
+ * The Pyramid renderers make an image pyramid for zoomable viewers in a single pass over the points.  Level 0 has
+ * pixelsX x pixelsY pixels over roi, and level k has ceil(pixelsX/2^k) x ceil(pixelsY/2^k) pixels that are exactly
+ * 2^k level 0 pixels wide, so the ROI of level k given by pyramidROI() may extend past roi.  The finest level is
+ * rendered once, padded to cover every level, and each coarser level is the 2x2 block sum of the level below,
+ * which is exact for pixel-integrated Gaussians.  The coarsest of the nLevels levels may be at most one pixel along
+ * the longer side, i.e., nLevels <= ceil(log2(max(pixelsX,pixelsY)))+1.  pyramidTiles() cuts a level into
+ * fixed-size tiles.
+ *
+ * The Sparse histogram renderers sort the pixel index of each emitter and sum runs of equal indexes, so time and
+ * memory scale with the number of points rather than the number of pixels.  They suit huge, sparsely populated
+ * images, and can return the image as an arma::SpMat.  Pixel sums match renderHist with Engine::Single exactly.
+ *
+ * Render statistics (per-phase times, points clipped, pixels written, scratch memory) are collected for renders
+ * made inside a RenderStatsScope when the library is built with SRRENDER_STATS (CMake option OPT_STATS).
+ *
+ * The Gaussian renderers optionally take a StencilTable of precomputed stencils.  The table's sigmaAccuracy is
+ * used in place of the sigmaAccuracy parameter, and emitters with sigmas outside the table are rendered exactly.
+ *
+ * renderGauss can instead take an ErrorBudget, which truncates each emitter's stencil separately in X and Y at the
+ * smallest halfwidth keeping the error of every pixel it drops under the budget, given the emitter's intensity,
+ * sigmas and position within its pixel.  Dim emitters get small stencils, down to a single pixel for dim or
+ * narrow emitters near a pixel center, while bright emitters are rendered as wide as needed.  The error in a
+ * pixel is at most the tolerance times the number of emitters truncated near it.
  */
 template<class FloatT=float, class IdxT=uint32_t>
 class SRRender2D{
@@ -36,21 +99,209 @@ public:
     using ImageT = arma::Mat<FloatT>;
     using MovieT = arma::Cube<FloatT>;
     using EmitterVecT = arma::Mat<FloatT>;
+    using StencilTableT = StencilTable<FloatT,IdxT>;
+    using PointViewT = PointView<FloatT>;
+    using PyramidT = arma::field<ImageT>;
+    using SpImageT = arma::SpMat<FloatT>;
+    using FrameSinkT = std::function<void(IdxT frame, const ImageT &im)>;
     static const FloatT DefaultSigmaAccuracy; //Default number of sigmas to render Gaussian at
+    static const IdxT DefaultTileSize; //Default tile edge length in pixels for the Tiled renderers
+    static const IdxT FFTSubpixels; //Histogram bins per pixel along each axis for Engine::FFT
+    static const IdxT FFTMaxSigmaGroups; //Maximum number of distinct (sigmaX,sigmaY) pairs for Engine::FFT
+
+    /** Rendering algorithms for renderHist and renderGauss.  Single, Parallel and Tiled give the same image.
+     * Single: serial.  Parallel: per-thread images summed at the end.  Tiled: threads own image tiles.
+     * FFT (renderGauss only): for each distinct sigma, a sub-pixel histogram is convolved with the pixel-integrated
+     * Gaussian by FFT, costing O(P log P) in the number of pixels P regardless of the number of points.  Pixel errors
+     * are under 1% of the peak for sigmas of one pixel and fall as 1/sigma^2.  Throws if the points have more than
+     * FFTMaxSigmaGroups distinct sigmas.
+     * Auto: the one of Single, Parallel and Tiled with the lowest estimated time in CostModel::global(), so it always
+     * gives the exact image.  The approximate FFT engine must be requested explicitly. */
+    enum class Engine {Auto, Single, Parallel, Tiled, FFT};
 
-    static void renderHist(const EmitterVecT &points, const VecT &roi, ImageT &im);
-    static void renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    /** Per-pixel error allowed for each emitter when truncating its stencil adaptively.
+     * Absolute: tolerance is in image intensity units.
+     * Relative: tolerance is a fraction of the largest single-emitter peak, I/(2*pi*sigmaX*sigmaY) in pixel units
+     * clamped to at most I, over all the points. */
+    struct ErrorBudget {
+        enum class Kind {Absolute, Relative};
+        Kind kind = Kind::Relative;
+        FloatT tolerance = static_cast<FloatT>(1e-3);
+    };
+
+    static void renderHist(const EmitterVecT &points, const VecT &roi, ImageT &im, Engine engine=Engine::Auto);
+    static void renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy=DefaultSigmaAccuracy,
+                            Engine engine=Engine::Auto);
     static void renderHistMovie(const EmitterVecT &points, const VecT &roi, MovieT &im);
     static void renderGaussMovie(const EmitterVecT &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
-//     static void checkPoints(const EmitterVecT &points);
+    static void renderHistMovieWindowed(const EmitterVecT &points, const VecT &roi, MovieT &movie, IdxT window,
+                                        IdxT stride=1);
+    static void renderGaussMovieWindowed(const EmitterVecT &points, const VecT &roi, MovieT &movie, IdxT window,
+                                         IdxT stride=1, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    static void renderHistMovieStream(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT nFrames,
+                                      const FrameSinkT &sink, IdxT framesInFlight=0);
+    static void renderGaussMovieStream(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT nFrames,
+                                       const FrameSinkT &sink, FloatT sigmaAccuracy=DefaultSigmaAccuracy,
+                                       IdxT framesInFlight=0);
+    static void renderHistChannels(const EmitterVecT &points, const VecT &roi, MovieT &channels);
+    static void renderGaussChannels(const EmitterVecT &points, const VecT &roi, MovieT &channels,
+                                    FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    static void renderHistChannels(const EmitterVecT &points, const VecT &roi, MovieT &im, const ImageT &weights);
+    static void renderGaussChannels(const EmitterVecT &points, const VecT &roi, MovieT &im, const ImageT &weights,
+                                    FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    static void renderHistTiled(const EmitterVecT &points, const VecT &roi, ImageT &im, IdxT tileSize=DefaultTileSize);
+    static void renderHistSparse(const EmitterVecT &points, const VecT &roi, ImageT &im);
+    static void renderHistSparse(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, SpImageT &im);
+    static void renderGaussTiled(const EmitterVecT &points, const VecT &roi, ImageT &im,
+                                 FloatT sigmaAccuracy=DefaultSigmaAccuracy, IdxT tileSize=DefaultTileSize);
+
+    static void renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, const StencilTableT &table,
+                            Engine engine=Engine::Auto);
+    static void renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, const ErrorBudget &budget,
+                            Engine engine=Engine::Auto);
+    static void renderGaussMovie(const EmitterVecT &points, const VecT &roi, MovieT &im, const StencilTableT &table);
+    static void renderGaussTiled(const EmitterVecT &points, const VecT &roi, ImageT &im, const StencilTableT &table,
+                                 IdxT tileSize=DefaultTileSize);
+    static void renderGaussPyramid(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT nLevels,
+                                   PyramidT &pyramid, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    static void renderGaussPyramid(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT nLevels,
+                                   PyramidT &pyramid, const StencilTableT &table);
+    static VecT pyramidROI(const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT level);
+    static arma::field<ImageT> pyramidTiles(const ImageT &level, IdxT tileSize);
+
+    template<class PointFloatT>
+    static void renderHist(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, Engine engine=Engine::Auto);
+    template<class PointFloatT>
+    static void renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im,
+                            FloatT sigmaAccuracy=DefaultSigmaAccuracy, Engine engine=Engine::Auto);
+    template<class PointFloatT>
+    static void renderHistMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im);
+    template<class PointFloatT>
+    static void renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                 FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    template<class PointFloatT>
+    static void renderHistMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie, IdxT window,
+                                        IdxT stride=1);
+    template<class PointFloatT>
+    static void renderGaussMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie, IdxT window,
+                                         IdxT stride=1, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    template<class PointFloatT>
+    static void renderHistMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                      IdxT nFrames, const FrameSinkT &sink, IdxT framesInFlight=0);
+    template<class PointFloatT>
+    static void renderGaussMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                       IdxT nFrames, const FrameSinkT &sink, FloatT sigmaAccuracy=DefaultSigmaAccuracy,
+                                       IdxT framesInFlight=0);
+    template<class PointFloatT>
+    static void renderHistChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &channels);
+    template<class PointFloatT>
+    static void renderGaussChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &channels,
+                                    FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    template<class PointFloatT>
+    static void renderHistChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                   const ImageT &weights);
+    template<class PointFloatT>
+    static void renderGaussChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                    const ImageT &weights, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    template<class PointFloatT>
+    static void renderHistTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im,
+                                IdxT tileSize=DefaultTileSize);
+    template<class PointFloatT>
+    static void renderHistSparse(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im);
+    template<class PointFloatT>
+    static void renderHistSparse(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                 SpImageT &im);
+    template<class PointFloatT>
+    static void renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im,
+                                 FloatT sigmaAccuracy=DefaultSigmaAccuracy, IdxT tileSize=DefaultTileSize);
+    template<class PointFloatT>
+    static void renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, const StencilTableT &table,
+                            Engine engine=Engine::Auto);
+    template<class PointFloatT>
+    static void renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, const ErrorBudget &budget,
+                            Engine engine=Engine::Auto);
+    template<class PointFloatT>
+    static void renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                 const StencilTableT &table);
+    template<class PointFloatT>
+    static void renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im,
+                                 const StencilTableT &table, IdxT tileSize=DefaultTileSize);
+    template<class PointFloatT>
+    static void renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                   IdxT nLevels, PyramidT &pyramid, FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+    template<class PointFloatT>
+    static void renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                   IdxT nLevels, PyramidT &pyramid, const StencilTableT &table);
 private:
+    friend StencilTableT;
+    friend class SRAccumulator2D<FloatT,IdxT>;
+    friend class SRRender3D<FloatT,IdxT>;
+    friend class SRIndexedRender2D<FloatT,IdxT>;
     static const FloatT normexp; // 1/sqrt(2);
 
     static void fill_stencil(IdxT size, FloatT x, FloatT sigma, VecT& stencil);
-    static void renderHistSingle(const EmitterVecT &points, const VecT &roi, ImageT &im);
-    static void renderHistParallel(const EmitterVecT &points, const VecT &roi, ImageT &im);
-    static void renderGaussSingle(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy);
-    static void renderGaussParallel(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy);
+    static const FloatT* make_stencil(IdxT clipMin, IdxT clipMax, FloatT X, FloatT sigma, FloatT sigmaAccuracy,
+                                      const StencilTableT *table, IdxT &min, IdxT &max, VecT &stencil);
+    static IdxT stencil_halfwidth(FloatT X, FloatT sigma, FloatT sigmaAccuracy, const StencilTableT *table);
+    static FloatT point_accuracy(const FloatT *accuracies, FloatT sigmaAccuracy, std::size_t n, int axis);
+    static bool stencil_span(IdxT pixels, FloatT X, IdxT halfwidth, IdxT &min, IdxT &max);
+    static void splat(FloatT *im, IdxT ld, FloatT I, IdxT xmin, IdxT xmax, const FloatT *xStencil,
+                      IdxT ymin, IdxT ymax, const FloatT *yStencil);
+    template<class PointFloatT>
+    static void checkPoints(const PointView<PointFloatT> &points, std::initializer_list<PointField> fields);
+    template<class PointFloatT>
+    static Engine select_engine(const PointView<PointFloatT> &points, const ImageT &im, const VecT &roi,
+                                FloatT sigmaAccuracy, const StencilTableT *table, bool gauss,
+                                const FloatT *accuracies=nullptr);
+    template<class PointFloatT>
+    static void renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                            const StencilTableT *table, Engine engine, const FloatT *accuracies=nullptr);
+    template<class PointFloatT>
+    static void adaptive_accuracies(const PointView<PointFloatT> &points, const VecT &roi, const ImageT &im,
+                                    const ErrorBudget &budget, std::vector<FloatT> &accuracies);
+    template<class PointFloatT>
+    static void renderHistSingle(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im);
+    template<class PointFloatT>
+    static void renderHistParallel(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im);
+    template<class PointFloatT>
+    static void sparse_hist(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                            std::vector<std::size_t> &pixels, std::vector<FloatT> &values);
+    template<class PointFloatT>
+    static void renderGaussSingle(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                  const StencilTableT *table, const FloatT *accuracies=nullptr);
+    template<class PointFloatT>
+    static bool sigma_groups(const PointView<PointFloatT> &points, std::vector<std::pair<PointFloatT,PointFloatT>> &groups,
+                             std::vector<IdxT> *groupOf);
+    template<class PointFloatT>
+    static void renderGaussFFT(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy);
+    static arma::Col<std::complex<FloatT>> fft_kernel(FloatT sigma, IdxT reach, IdxT len);
+    static IdxT fft_length(IdxT n);
+    template<class PointFloatT>
+    static void renderGaussParallel(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                    const StencilTableT *table, const FloatT *accuracies=nullptr);
+    template<class PointFloatT>
+    static void renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy,
+                                 const StencilTableT *table);
+    template<class PointFloatT>
+    static void renderMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie, IdxT window,
+                                    IdxT stride, FloatT sigmaAccuracy, bool gauss);
+    template<class PointFloatT>
+    static void renderMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                  IdxT nFrames, const FrameSinkT &sink, IdxT framesInFlight, FloatT sigmaAccuracy,
+                                  bool gauss);
+    template<class PointFloatT>
+    static void renderChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im, const ImageT &weights,
+                               FloatT sigmaAccuracy, bool gauss);
+    template<class PointFloatT>
+    static void renderHistTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, IdxT tileSize,
+                                bool accumulate);
+    template<class PointFloatT>
+    static void renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                 const StencilTableT *table, IdxT tileSize, bool accumulate,
+                                 const FloatT *accuracies=nullptr);
+    template<class PointFloatT>
+    static void renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                   IdxT nLevels, PyramidT &pyramid, FloatT sigmaAccuracy, const StencilTableT *table);
 };
 
 } /* namespace srrender */
@@ -0,0 +1,49 @@
+/** @file SRRender3D.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline and templated functions for SRRender3D.
+ *
+ * Volumetric rendering of 3D SR emitter localizations
+ */
+
+#ifndef SRRENDER_SRRENDER3D_H
+#define SRRENDER_SRRENDER3D_H
+
+#include "SRRender/SRRender.h"
+
+namespace srrender {
+
+/**
+ * Points format.  Row-oriented each row is a point, each column is a property
+ * 3D renderHist Columns: [I X Y Z]
+ * 3D renderGauss Columns:[I X Y Z sigmaX sigmaY sigmaZ]
+ *
+ * The roi=[xmin xmax ymin ymax zmin zmax] gives the volume rendered into vol, which is indexed vol(y,x,z) like the
+ * SRRender2D images, so each slice is an SRRender2D image of one z-plane.
+ *
+ * Gaussians are integrated over each voxel and rendered as the separable product of per-axis stencils, out to
+ * sigmaAccuracy sigmas on each axis.  The volume is split into slabs of whole z-slices and emitters are binned into
+ * every slab their stencil overlaps, so each thread renders whole slabs directly into the volume without private
+ * copies of it.  Results do not depend on the number of threads.
+ */
+template<class FloatT=float, class IdxT=uint32_t>
+class SRRender3D{
+public:
+    using VecT = arma::Col<FloatT>;
+    using VolumeT = arma::Cube<FloatT>;
+    using EmitterVecT = arma::Mat<FloatT>;
+    static const FloatT DefaultSigmaAccuracy; //Default number of sigmas to render Gaussian at
+    static const IdxT DefaultSlabSize; //Default slab thickness in z-slices
+
+    static void renderHist(const EmitterVecT &points, const VecT &roi, VolumeT &vol);
+    static void renderGauss(const EmitterVecT &points, const VecT &roi, VolumeT &vol,
+                            FloatT sigmaAccuracy=DefaultSigmaAccuracy);
+private:
+    using RenderT = SRRender2D<FloatT,IdxT>;
+
+    static void checkPoints(const EmitterVecT &points, const VecT &roi, IdxT nColumns);
+};
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_SRRENDER3D_H */
@@ -0,0 +1,92 @@
+/** @file StencilTable.h
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class declaration and inline and templated functions for StencilTable.
+ *
+ * Precomputed Gaussian stencils for SRRender2D
+ */
+
+#ifndef SRRENDER_STENCILTABLE_H
+#define SRRENDER_STENCILTABLE_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <armadillo>
+
+namespace srrender {
+
+/**
+ * A lookup table of pixel-integrated 1D Gaussian stencils, replacing the erf evaluations of the exact stencils.
+ *
+ * Stencils are keyed by the sub-pixel offset of the emitter, quantized into offsetLevels equal bins per pixel, and
+ * by sigma in output pixels, quantized into sigmaLevels geometrically spaced levels over [sigmaMin, sigmaMax].
+ * Each stencil covers the pixels floor(X)-halfwidth ... floor(X)+halfwidth, where halfwidth is computed from the
+ * quantized sigma and sigmaAccuracy exactly as for the exact stencils.
+ *
+ * Error: Each stencil value is the exact value for an emitter shifted by at most 1/(2*offsetLevels) pixels and
+ * with its sigma scaled by at most sqrt(r) where r=(sigmaMax/sigmaMin)^(1/(sigmaLevels-1)) is the sigma level
+ * ratio, so sigmas in [sigmaMin/sqrt(r), sigmaMax*sqrt(r)] are covered.  For a unit-intensity emitter the absolute
+ * error of any 1D stencil value is bounded by
+ *      sqrt(r)/(2*offsetLevels*sigmaMin*sqrt(2*pi)) + 2*phi(1)*(sqrt(r)-1)
+ * where phi(1)=0.242 is the standard normal density at 1.  The 2D stencil error is at most twice this bound.
+ * Emitters whose sigma rounds to a different halfwidth than their table level additionally differ by the Gaussian
+ * tail beyond sigmaAccuracy sigmas, which is the truncation error already present in the exact stencils.
+ * errorBound() gives the bound so callers can choose the quantization to match the accuracy they need.
+ */
+template<class FloatT=float, class IdxT=uint32_t>
+class StencilTable {
+public:
+    using VecT = arma::Col<FloatT>;
+
+    StencilTable(FloatT sigmaMin, FloatT sigmaMax, IdxT sigmaLevels, IdxT offsetLevels, FloatT sigmaAccuracy);
+
+    FloatT get_sigma_min() const { return sigma_min; }
+    FloatT get_sigma_max() const { return sigma_max; }
+    IdxT get_sigma_levels() const { return sigma_levels; }
+    IdxT get_offset_levels() const { return offset_levels; }
+    FloatT get_sigma_accuracy() const { return sigma_accuracy; }
+    std::size_t get_table_size() const { return stencils.n_elem; } //Total number of stencil values stored
+
+    FloatT errorBound() const;
+    static FloatT errorBound(FloatT sigmaMin, FloatT sigmaMax, IdxT sigmaLevels, IdxT offsetLevels);
+
+    /** Look up the stencil for an emitter at pixel coordinate X with width sigma in output pixels.
+     * Returns a pointer to 2*halfwidth+1 stencil values for pixels floor(X)-halfwidth ... floor(X)+halfwidth,
+     * or nullptr if sigma is not covered by the table.
+     */
+    const FloatT* lookup(FloatT X, FloatT sigma, IdxT &halfwidth) const;
+
+private:
+    FloatT sigma_min;
+    FloatT sigma_max;
+    IdxT sigma_levels;
+    IdxT offset_levels;
+    FloatT sigma_accuracy;
+    FloatT log_sigma_min; //log of first sigma level
+    FloatT inv_log_ratio; //1/log(r) for sigma level ratio r
+    FloatT log_lookup_min; //log of smallest sigma covered
+    FloatT log_lookup_max; //log of largest sigma covered
+    std::vector<IdxT> level_halfwidth; //halfwidth of stencils for each sigma level
+    std::vector<std::size_t> level_start; //start of each sigma level's stencils in stencils
+    VecT stencils;
+};
+
+template<class FloatT, class IdxT>
+inline
+const FloatT* StencilTable<FloatT,IdxT>::lookup(FloatT X, FloatT sigma, IdxT &halfwidth) const
+{
+    FloatT logSigma = std::log(sigma);
+    if(!(logSigma >= log_lookup_min && logSigma <= log_lookup_max)) return nullptr;
+    IdxT level = static_cast<IdxT>((logSigma-log_sigma_min)*inv_log_ratio + 0.5);
+    if(level >= sigma_levels) level = sigma_levels-1;
+    FloatT frac = X-std::floor(X);
+    IdxT offset = static_cast<IdxT>(frac*offset_levels);
+    if(offset >= offset_levels) offset = offset_levels-1;
+    halfwidth = level_halfwidth[level];
+    return stencils.memptr() + level_start[level] + static_cast<std::size_t>(offset)*(2*halfwidth+1);
+}
+
+} /* namespace srrender */
+
+#endif /* SRRENDER_STENCILTABLE_H */
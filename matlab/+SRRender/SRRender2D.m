@@ -74,7 +74,33 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             obj.ROI = obj.checkROI(roi);
         end
         
-        function [im, imCoords] = renderHist(obj, points, imSizePx, roi)
+        function setRenderOptions(obj, nThreads, affinity, firstTouch)
+            % Set the threading options for all subsequent renders by this class.  The OpenMP settings of the
+            % MATLAB process are not changed, so other libraries are unaffected.
+            %
+            % [in] nThreads - (scalar) Number of render threads.  0 uses one per hardware thread. [Default: 0]
+            % [in] affinity - [optional] Thread binding: 'default' (OMP_PROC_BIND), 'close' or 'spread'.  Use
+            %                 'spread' on multi-socket machines to use the memory bandwidth of every socket.
+            %                 [Default: 'default']
+            % [in] firstTouch - [optional] logical.  If true, render threads first-touch the image regions they write,
+            %                   so image memory is placed on the NUMA node that uses it. [Default: false]
+            if nargin<2
+                nThreads = 0;
+            end
+            if nargin<3
+                affinity = 'default';
+            end
+            if nargin<4
+                firstTouch = false;
+            end
+            affinityIdx = find(strcmpi(affinity, {'default','close','spread'}),1)-1;
+            if isempty(affinityIdx)
+                error('SRRender2D:setRenderOptions','Unknown affinity: %s', affinity);
+            end
+            obj.callstatic('setRenderOptions', uint32(nThreads), uint32(affinityIdx), uint32(logical(firstTouch)));
+        end
+
+        function [im, imCoords, stats] = renderHist(obj, points, imSizePx, roi)
             % Generates a single histogram image of the points weigheted by intensity.  The points columns
             % for sigma_x and sigma_y are irrelevent for this method.
             %
@@ -85,6 +111,8 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             % [out] im - A hisrogram image with maximum dimension given by imSizePx.
             % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
             %                  the resulting image. 
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
             if nargin<4
                 roi = obj.ROI;
             else
@@ -93,10 +121,14 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             points = obj.checkPoints(points);
             [im, imCoords] = obj.makeImage(imSizePx, roi);
             effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
-            obj.callstatic('renderHist', points, effectiveROI, im);
+            if nargout>2
+                stats = obj.callstatic('renderHist', points, effectiveROI, im);
+            else
+                obj.callstatic('renderHist', points, effectiveROI, im);
+            end
         end
 
-        function [im, imCoords] = renderGauss(obj, points, imSizePx, roi)
+        function [im, imCoords, stats] = renderGauss(obj, points, imSizePx, roi)
             % Generates a single frame of a gaussian blob representation of the given points.
             %
             % Note: to control width of rendered gaussians in sigma multiples set obj.sigmaAccuracy
@@ -108,6 +140,8 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             % [out] im - A hisrogram image with maximum dimension given by imSizePx.
             % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
             %                  the resulting image. 
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
             if nargin<4
                 roi = obj.ROI;
             else
@@ -116,10 +150,50 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             points = obj.checkPoints(points);
             [im, imCoords] = obj.makeImage(imSizePx, roi);
             effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
-            obj.callstatic('renderGauss', points, effectiveROI, obj.sigmaAccuracy, im);
+            if nargout>2
+                stats = obj.callstatic('renderGauss', points, effectiveROI, obj.sigmaAccuracy, im);
+            else
+                obj.callstatic('renderGauss', points, effectiveROI, obj.sigmaAccuracy, im);
+            end
         end
 
-        function [im, imCoords] = renderHistMovie(obj, points, imSizePx, roi)
+        function [im, imCoords, stats] = renderGaussBudget(obj, points, tolerance, relative, imSizePx, roi)
+            % Generates a single frame of a gaussian blob representation of the given points, truncating each
+            % gaussian at the smallest width that keeps the error it adds to any pixel under tolerance.  Dim
+            % emitters are rendered with small stencils, so this is much faster than renderGauss for data
+            % with a wide range of intensities.  Errors from overlapping emitters add.
+            %
+            % [in] points - matrix of points in standard format
+            % [in] tolerance - (scalar) Largest error any one emitter may add to a pixel.
+            % [in] relative - (logical) If true tolerance is a fraction of the peak of the brightest emitter,
+            %                 otherwise it is in intensity units.
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] im - A gaussian blob image with maximum dimension given by imSizePx.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
+            if nargin<6
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            if ~isscalar(tolerance) || ~(tolerance>0) || ~isfinite(tolerance)
+                error('SRRender2D:renderGaussBudget','tolerance must be a positive finite scalar');
+            end
+            points = obj.checkPoints(points);
+            [im, imCoords] = obj.makeImage(imSizePx, roi);
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            if nargout>2
+                stats = obj.callstatic('renderGaussBudget', points, effectiveROI, obj.datacaster(tolerance), uint32(logical(relative)), im);
+            else
+                obj.callstatic('renderGaussBudget', points, effectiveROI, obj.datacaster(tolerance), uint32(logical(relative)), im);
+            end
+        end
+
+        function [im, imCoords, stats] = renderHistMovie(obj, points, imSizePx, roi)
             % Generates a sequence of histogram images of the points weigheted by intensity.  The points columns
             % for sigma_x and sigma_y are irrelevent for this method, but must still be included.  The
             % column format is [I x y sigma_x sigma_y frameIdx].  frameIdx starts at 1 and must be an
@@ -134,6 +208,8 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             % [out] im - A hisrogram image with maximum dimension given by imSizePx.
             % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
             %                  the resulting image. 
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
             if nargin<4
                 roi = obj.ROI;
             else
@@ -144,10 +220,14 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             [im, imCoords] = obj.makeImage(imSizePx, roi, nFrames);
             effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
             points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
-            obj.callstatic('renderHistMovie', points, effectiveROI, im);
+            if nargout>2
+                stats = obj.callstatic('renderHistMovie', points, effectiveROI, im);
+            else
+                obj.callstatic('renderHistMovie', points, effectiveROI, im);
+            end
         end
 
-        function [im, imCoords] = renderGaussMovie(obj, points, imSizePx, roi)
+        function [im, imCoords, stats] = renderGaussMovie(obj, points, imSizePx, roi)
             % Generates a sequence of gaussian blob images of the points weigheted by intensity.  The
             % column format is [I x y sigma_x sigma_y frameIdx].  frameIdx starts at 1 and must be an
             % integer.
@@ -161,6 +241,8 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             % [out] im - A hisrogram image with maximum dimension given by imSizePx.
             % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
             %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
             if nargin<4
                 roi = obj.ROI;
             else
@@ -171,7 +253,217 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             [im, imCoords] = obj.makeImage(imSizePx, roi, nFrames);
             effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
             points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
-            obj.callstatic('renderGaussMovie', points, effectiveROI, im);
+            if nargout>2
+                stats = obj.callstatic('renderGaussMovie', points, effectiveROI, im);
+            else
+                obj.callstatic('renderGaussMovie', points, effectiveROI, im);
+            end
+        end
+
+        function [im, imCoords, stats] = renderHistMovieWindowed(obj, points, window, stride, imSizePx, roi)
+            % Generates a sliding-window sequence of histogram images of the points weigheted by intensity.
+            % Output frame k sums input frames [(k-1)*stride+1, (k-1)*stride+window].  The column format is
+            % [I x y sigma_x sigma_y frameIdx].  frameIdx starts at 1 and must be an integer.  The cost does not
+            % grow with window, so long overlapping windows are cheap.
+            %
+            % [in] points - matrix of points in standard format with last column (col 6) giving frame
+            %               index.  Frame indexes should start at 1 and be integer valued.
+            % [in] window - (scalar) Number of input frames summed into each output frame.
+            % [in] stride - (scalar) Number of input frames between the starts of consecutive windows.
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] im - A movie with one frame per window and maximum dimension given by imSizePx.
+            %            Emitters after the last whole window are not rendered.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
+            if nargin<6
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            if window<1 || stride<1 || round(window)~=window || round(stride)~=stride
+                error('SRRender2D:renderHistMovieWindowed','window and stride must be positive integers');
+            end
+            points = obj.checkPointsMovie(points);
+            nFrames = max(points(:,6));
+            nOut = max(1, floor((nFrames-window)/stride)+1);
+            [im, imCoords] = obj.makeImage(imSizePx, roi, nOut);
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
+            if nargout>2
+                stats = obj.callstatic('renderHistMovieWindowed', points, effectiveROI, uint32(window), uint32(stride), im);
+            else
+                obj.callstatic('renderHistMovieWindowed', points, effectiveROI, uint32(window), uint32(stride), im);
+            end
+        end
+
+        function [im, imCoords, stats] = renderGaussMovieWindowed(obj, points, window, stride, imSizePx, roi)
+            % Generates a sliding-window sequence of gaussian blob images of the points weigheted by intensity.
+            % Output frame k sums input frames [(k-1)*stride+1, (k-1)*stride+window].  The column format is
+            % [I x y sigma_x sigma_y frameIdx].  frameIdx starts at 1 and must be an integer.  The cost does not
+            % grow with window, so long overlapping windows are cheap.
+            %
+            % [in] points - matrix of points in standard format with last column (col 6) giving frame
+            %               index.  Frame indexes should start at 1 and be integer valued.
+            % [in] window - (scalar) Number of input frames summed into each output frame.
+            % [in] stride - (scalar) Number of input frames between the starts of consecutive windows.
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] im - A movie with one frame per window and maximum dimension given by imSizePx.
+            %            Emitters after the last whole window are not rendered.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
+            if nargin<6
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            if window<1 || stride<1 || round(window)~=window || round(stride)~=stride
+                error('SRRender2D:renderGaussMovieWindowed','window and stride must be positive integers');
+            end
+            points = obj.checkPointsMovie(points);
+            nFrames = max(points(:,6));
+            nOut = max(1, floor((nFrames-window)/stride)+1);
+            [im, imCoords] = obj.makeImage(imSizePx, roi, nOut);
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
+            if nargout>2
+                stats = obj.callstatic('renderGaussMovieWindowed', points, effectiveROI, uint32(window), uint32(stride), obj.sigmaAccuracy, im);
+            else
+                obj.callstatic('renderGaussMovieWindowed', points, effectiveROI, uint32(window), uint32(stride), obj.sigmaAccuracy, im);
+            end
+        end
+
+        function [im, imCoords, stats] = renderHistChannels(obj, points, weights, imSizePx, roi)
+            % Generates a multi-channel histogram image of the points weigheted by intensity in a single pass.
+            % The column format is [I x y sigma_x sigma_y channelIdx].  channelIdx starts at 1 and must be an
+            % integer.  A point of channel c adds I*weights(c,k) to image slice k.
+            %
+            % [in] points - matrix of points in standard format with last column (col 6) giving channel
+            %               index.  Channel indexes should start at 1 and be integer valued.
+            % [in] weights - nChannels x nSlices matrix of channel weights, e.g., nChannels x 3 colors for an
+            %                RGB image.  [Default: [] for eye(nChannels), one slice per channel]
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] im - A multi-channel image with one slice per column of weights and maximum dimension given
+            %            by imSizePx.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
+            if nargin<5
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            points = obj.checkPointsMovie(points);
+            weights = obj.checkChannelWeights(weights, points);
+            [im, imCoords] = obj.makeImage(imSizePx, roi, size(weights,2));
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
+            if nargout>2
+                stats = obj.callstatic('renderHistChannels', points, effectiveROI, weights, im);
+            else
+                obj.callstatic('renderHistChannels', points, effectiveROI, weights, im);
+            end
+        end
+
+        function [im, imCoords, stats] = renderGaussChannels(obj, points, weights, imSizePx, roi)
+            % Generates a multi-channel gaussian blob image of the points weigheted by intensity in a single
+            % pass, computing each point's stencil once for all the slices it contributes to.  The column format
+            % is [I x y sigma_x sigma_y channelIdx].  channelIdx starts at 1 and must be an integer.  A point of
+            % channel c adds I*weights(c,k) times its gaussian to image slice k.
+            %
+            % [in] points - matrix of points in standard format with last column (col 6) giving channel
+            %               index.  Channel indexes should start at 1 and be integer valued.
+            % [in] weights - nChannels x nSlices matrix of channel weights, e.g., nChannels x 3 colors for an
+            %                RGB image.  [Default: [] for eye(nChannels), one slice per channel]
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] im - A multi-channel image with one slice per column of weights and maximum dimension given
+            %            by imSizePx.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            % [out] stats - [optional] struct of render statistics: per-phase times, points rendered and clipped,
+            %               pixels written and scratch memory.  All zero unless built with OPT_STATS.
+            if nargin<5
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            points = obj.checkPointsMovie(points);
+            weights = obj.checkChannelWeights(weights, points);
+            [im, imCoords] = obj.makeImage(imSizePx, roi, size(weights,2));
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            points(:,6) = points(:,6) -1; %Convert to 0-based indexing for C++
+            if nargout>2
+                stats = obj.callstatic('renderGaussChannels', points, effectiveROI, weights, obj.sigmaAccuracy, im);
+            else
+                obj.callstatic('renderGaussChannels', points, effectiveROI, weights, obj.sigmaAccuracy, im);
+            end
+        end
+
+        function [id, imCoords] = renderAsync(obj, points, imSizePx, mode, roi)
+            % Start rendering an image in the background and return immediately.  Points are rendered in a random
+            % order, so renderAsyncPreview gives a usable image within milliseconds that converges to the final image.
+            %
+            % [in] points - matrix of points in standard format [I x y sigma_x sigma_y].
+            % [in] imSizePx - (scalar) The image size of resulting image along the longest coordinate of roi.
+            % [in] mode - [optional] 'gauss' or 'hist' [Default: 'gauss']
+            % [in] roi - [optional] The roi to image for with format [xmin, xmax, ymin, ymax].
+            %            [Default: use the class's obj.ROI property]
+            % [out] id - Handle of the render for renderAsyncProgress, renderAsyncPreview, renderAsyncWait and
+            %            renderAsyncCancel.  Each render must be finished with renderAsyncWait or renderAsyncCancel.
+            % [out] imCoords - An imref2d object describing the mapping from pixels to real world coordinates in
+            %                  the resulting image.
+            if nargin<4
+                mode = 'gauss';
+            end
+            if nargin<5
+                roi = obj.ROI;
+            else
+                roi = obj.checkROI(roi);
+            end
+            points = obj.checkPoints(points);
+            [im, imCoords] = obj.makeImage(imSizePx, roi);
+            effectiveROI = obj.datacaster([imCoords.XWorldLimits, imCoords.YWorldLimits]);
+            gauss = uint32(strcmpi(mode,'gauss'));
+            id = obj.callstatic('renderAsyncStart', points, effectiveROI, obj.datacaster(size(im)), gauss, ...
+                                obj.datacaster(obj.sigmaAccuracy));
+        end
+
+        function [progress, done] = renderAsyncProgress(obj, id)
+            % [in] id - Handle from renderAsync
+            % [out] progress - Fraction of the points rendered so far
+            % [out] done - True if the render has finished or was stopped
+            [progress, done] = obj.callstatic('renderAsyncProgress', uint32(id));
+        end
+
+        function im = renderAsyncPreview(obj, id)
+            % [in] id - Handle from renderAsync
+            % [out] im - The image of the points rendered so far, scaled to the intensity of the full image
+            im = obj.callstatic('renderAsyncSnapshot', uint32(id));
+        end
+
+        function im = renderAsyncWait(obj, id)
+            % Block until a background render finishes and release its handle.
+            % [in] id - Handle from renderAsync
+            % [out] im - The rendered image
+            im = obj.callstatic('renderAsyncWait', uint32(id));
+        end
+
+        function renderAsyncCancel(obj, id)
+            % Stop a background render and release its handle.
+            % [in] id - Handle from renderAsync
+            obj.callstatic('renderAsyncCancel', uint32(id));
         end
     end %public methods
 
@@ -194,6 +486,18 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             end
         end
 
+        function weights = checkChannelWeights(obj, weights, points)
+            % Default to one slice per channel, and check there is a row of weights for every channel index
+            nChannels = max(points(:,6));
+            if isempty(weights)
+                weights = eye(nChannels);
+            end
+            weights = obj.datacaster(weights);
+            if ~ismatrix(weights) || size(weights,1)<nChannels || any(~isfinite(weights(:)))
+                error('SRRender2D:checkChannelWeights','Channel weights need a finite row for each of %i channels', nChannels);
+            end
+        end
+
         function [im, imCoords] = makeImage(obj, imSizePx, roi, nFrames)
             % Make a blank image or video sequence of the correct size and type
             if nargin==3
@@ -302,8 +606,9 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             srr = SRRender2D(roi,'single');
             min_frame=min(srtest.Results.FrameNum);
             movieSize = 2048;
-            frameCompressFactor = 10; %How many frames of emitters to group together
-            frameIdx = ceil((srtest.Results.FrameNum-min_frame+1)/frameCompressFactor);
+            movieWindow = 20; %How many frames of emitters to group together in each movie frame
+            movieStride = 10; %How many frames to advance between movie frames
+            frameIdx = srtest.Results.FrameNum-min_frame+1;
             nPoints = length(srtest.Results.X);
 
             %Change intensities
@@ -334,13 +639,13 @@ classdef SRRender2D < MexIFace.MexIFaceMixin
             
             %Histogram movie
             tic;
-            hist_movie = srr.renderHistMovie(points,movieSize);
+            hist_movie = srr.renderHistMovieWindowed(points,movieWindow,movieStride,movieSize);
             elapsed = toc;
             fprintf('Render Histogram Movie [N=%i] Time:%.5fs Emitters/s:%.4g\n', tPoints, elapsed, tPoints/elapsed);
 
             %Gaussian movie
             tic;
-            gauss_movie = srr.renderGaussMovie(points,movieSize);
+            gauss_movie = srr.renderGaussMovieWindowed(points,movieWindow,movieStride,movieSize);
             elapsed = toc;
             fprintf('Render Gaussian Movie [N=%i] Time:%.5fs Emitters/s:%.4g\n', tPoints, elapsed, tPoints/elapsed);
             srr.viewDipImage(histim);
@@ -0,0 +1,240 @@
+/** @file CostModel.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definitions for CostModel.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include "SRRender/CostModel.h"
+#include "SRRender/SRRender.h"
+
+namespace srrender {
+
+namespace {
+
+std::mutex global_mutex;
+std::unique_ptr<CostModel> global_model;
+
+/* Minimum time of func() in nanoseconds over repeats runs after a warm-up run */
+template<class FuncT>
+double time_ns(FuncT func, int repeats=3)
+{
+    func();
+    double best = INFINITY;
+    for(int k=0; k<repeats; k++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        best = std::min(best, std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count());
+    }
+    return best;
+}
+
+/* N unit-intensity points with the given sigma placed uniformly at least margin from the edges of [0,size]^2 */
+arma::mat calibration_points(std::size_t N, double size, double sigma, double margin)
+{
+    std::mt19937 generator(N);
+    std::uniform_real_distribution<double> pos(margin, size-margin);
+    arma::mat points(N,5);
+    for(std::size_t n=0; n<N; n++) {
+        points(n,0) = 1;
+        points(n,1) = pos(generator);
+        points(n,2) = pos(generator);
+        points(n,3) = sigma;
+        points(n,4) = sigma;
+    }
+    return points;
+}
+
+/* The value of the coefficient coef for which model estimates the given cost of problem as measured nanoseconds.
+ * Each cost is linear in each coefficient. */
+double fit_coefficient(CostModel model, double CostModel::*coef, double CostModel::Costs::*cost,
+                       const CostModel::Problem &problem, double measured)
+{
+    model.*coef = 0;
+    double base = model.estimate(problem).*cost;
+    model.*coef = 1;
+    double slope = model.estimate(problem).*cost - base;
+    return (measured-base)/slope;
+}
+
+} /* namespace */
+
+CostModel::Costs CostModel::estimate(const Problem &problem) const
+{
+    double N = static_cast<double>(problem.nPoints);
+    double sx = std::max(1., std::min(problem.stencilX, static_cast<double>(problem.pixelsX)));
+    double sy = std::max(1., std::min(problem.stencilY, static_cast<double>(problem.pixelsY)));
+    double bytes = static_cast<double>(problem.pixelsX)*problem.pixelsY*problem.bytesPerPixel;
+    double stencils = problem.computeStencils ? stencilNs*(sx+sy) : 0;
+    double work = N*(pointNs + stencils + splatNs*sx*sy);
+    double tile = static_cast<double>(std::max<std::size_t>(1,problem.tileSize));
+    double tiles = std::ceil(problem.pixelsX/tile)*std::ceil(problem.pixelsY/tile);
+    double overlap = (1+(sx-1)/tile)*(1+(sy-1)/tile); //Tiles touched per point, each recomputing its stencils
+    double threads = std::max(1, problem.threads);
+    double tileThreads = std::max(1., std::min(threads, tiles));
+
+    Costs costs;
+    costs.single = work + memNsPerByte*bytes;
+    costs.parallel = work/threads + memNsPerByte*bytes*(2*threads+1) + parallelNs;
+    costs.tiled = (2*binNs*N + N*overlap*(pointNs+stencils) + N*splatNs*sx*sy)/tileThreads + memNsPerByte*bytes
+                  + parallelNs;
+    costs.fft = INFINITY;
+    if(problem.sigmaGroups>0)
+        costs.fft = problem.sigmaGroups*(fftNs*fft_elements(problem)/threads + memNsPerByte*bytes*(problem.subpixels+1))
+                    + N*pointNs + parallelNs;
+    return costs;
+}
+
+/* The FFT engine work for one sigma: forward and inverse transforms of the padded sub-pixel histogram columns,
+ * then of the rows of the column-blurred image.  Stencil sizes give the padding.
+ */
+double CostModel::fft_elements(const Problem &problem)
+{
+    double s = static_cast<double>(problem.subpixels);
+    double padX = (problem.stencilX+1)/2*s;
+    double padY = (problem.stencilY+1)/2*s;
+    double fineX = problem.pixelsX*s + 2*padX;
+    double lengthY = problem.pixelsY*s + 3*padY;
+    double lengthX = fineX + padX;
+    return 2*fineX*lengthY*std::log2(lengthY) + 2*problem.pixelsY*lengthX*std::log2(lengthX);
+}
+
+/* Fit the coefficients from timed renders.  Single engine Gaussian renders with three stencil sizes separate the
+ * per-point, per-stencil-value and per-pixel costs.  The binning and FFT costs are then fit to Tiled and FFT renders
+ * by solving estimate() for them, so the measured times are divided by the same thread counts estimate() uses.
+ */
+CostModel CostModel::calibrate()
+{
+    using RenderT = SRRender2D<double>;
+    CostModel model;
+    model.parallelNs = time_ns([]{
+        #pragma omp parallel
+        { }
+    }, 20);
+    arma::mat big(2048,2048);
+    big.zeros();
+    model.memNsPerByte = time_ns([&]{ big.zeros(); }) / (big.n_elem*sizeof(double));
+    big.reset();
+
+    const double sigmaAccuracy = 5;
+    //Halfwidths as computed by SRRender2D::stencil_halfwidth
+    auto halfwidth = [&](double sigma) { return std::floor(0.5+sigmaAccuracy*sigma); };
+
+    //Per point costs g_i = point + 2*s_i*stencil + s_i^2*splat for unclipped stencils of size s_i = 2*halfwidth+1
+    const double size = 256;
+    arma::vec roi = {0, size, 0, size};
+    arma::mat im(256,256);
+    double zeroNs = model.memNsPerByte*im.n_elem*sizeof(double);
+    const double sigmas[3] = {0.5, 2, 6};
+    const std::size_t counts[3] = {50000, 10000, 2000};
+    double s[3], g[3];
+    for(int i=0; i<3; i++) {
+        double hw = halfwidth(sigmas[i]);
+        s[i] = 2*hw+1;
+        if((i>0 && s[i]<2*s[i-1]) || 2*(hw+1)>=size)
+            throw SRRenderError("BadCalibration","Calibration stencil sizes must be distinct and fit the image");
+        arma::mat points = calibration_points(counts[i], size, sigmas[i], hw+1);
+        g[i] = (time_ns([&]{ RenderT::renderGauss(points, roi, im, sigmaAccuracy, RenderT::Engine::Single); })-zeroNs)
+               / counts[i];
+    }
+    double q1 = (g[1]-g[0])/(s[1]-s[0]); //2*stencil + (s_1+s_0)*splat
+    double q2 = (g[2]-g[0])/(s[2]-s[0]); //2*stencil + (s_2+s_0)*splat
+    const double minNs = 1e-3;
+    model.splatNs = std::max(minNs, (q2-q1)/(s[2]-s[1]));
+    model.stencilNs = std::max(minNs, (q1-(s[1]+s[0])*model.splatNs)/2);
+    model.pointNs = std::max(minNs, g[0]-2*s[0]*model.stencilNs-s[0]*s[0]*model.splatNs);
+
+    //Binning and FFT renders on an image with at least as many tiles as threads
+    Problem problem;
+    problem.threads = RenderOptionsScope::threads();
+    problem.tileSize = RenderT::DefaultTileSize;
+    problem.bytesPerPixel = sizeof(double);
+    std::size_t tilesPerSide = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(problem.threads))));
+    const double largeSize = static_cast<double>(tilesPerSide*problem.tileSize);
+    arma::vec largeRoi = {0, largeSize, 0, largeSize};
+    arma::mat large(tilesPerSide*problem.tileSize, tilesPerSide*problem.tileSize);
+    problem.pixelsX = large.n_cols;
+    problem.pixelsY = large.n_rows;
+
+    problem.nPoints = 20000*tilesPerSide*tilesPerSide;
+    arma::mat hist = calibration_points(problem.nPoints, largeSize, 1, 0);
+    //Histogram points skip the Gaussian point setup, so their point cost comes from a Single render of the same points
+    double single = time_ns([&]{ RenderT::renderHist(hist, largeRoi, large, RenderT::Engine::Single); });
+    double tiled = time_ns([&]{ RenderT::renderHist(hist, largeRoi, large, RenderT::Engine::Tiled); });
+    CostModel histModel = model;
+    histModel.pointNs = std::max(minNs, fit_coefficient(model, &CostModel::pointNs, &Costs::single, problem, single));
+    model.binNs = std::max(minNs, fit_coefficient(histModel, &CostModel::binNs, &Costs::tiled, problem, tiled));
+    hist.reset();
+
+    const double fftSigma = 2;
+    problem.nPoints = 10000;
+    problem.stencilX = problem.stencilY = 2*halfwidth(fftSigma)+1;
+    problem.computeStencils = true;
+    problem.subpixels = RenderT::FFTSubpixels;
+    problem.sigmaGroups = 1;
+    arma::mat wide = calibration_points(problem.nPoints, largeSize, fftSigma, halfwidth(fftSigma)+1);
+    double fft = time_ns([&]{ RenderT::renderGauss(wide, largeRoi, large, sigmaAccuracy, RenderT::Engine::FFT); }, 1);
+    model.fftNs = std::max(minNs, fit_coefficient(model, &CostModel::fftNs, &Costs::fft, problem, fft));
+    return model;
+}
+
+void CostModel::save(const std::string &path) const
+{
+    std::ofstream out(path);
+    if(!out) throw SRRenderError("BadCostModelFile","Unable to write cost model file: "+path);
+    out.precision(10);
+    out<<"pointNs "<<pointNs<<"\n";
+    out<<"stencilNs "<<stencilNs<<"\n";
+    out<<"splatNs "<<splatNs<<"\n";
+    out<<"binNs "<<binNs<<"\n";
+    out<<"memNsPerByte "<<memNsPerByte<<"\n";
+    out<<"parallelNs "<<parallelNs<<"\n";
+    out<<"fftNs "<<fftNs<<"\n";
+    if(!out) throw SRRenderError("BadCostModelFile","Error writing cost model file: "+path);
+}
+
+/* Load a model saved by save().  Coefficients missing from the file keep their default values. */
+CostModel CostModel::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if(!in) throw SRRenderError("BadCostModelFile","Unable to read cost model file: "+path);
+    CostModel model;
+    std::string name;
+    double value;
+    while(in>>name>>value) {
+        if(name=="pointNs") model.pointNs = value;
+        else if(name=="stencilNs") model.stencilNs = value;
+        else if(name=="splatNs") model.splatNs = value;
+        else if(name=="binNs") model.binNs = value;
+        else if(name=="memNsPerByte") model.memNsPerByte = value;
+        else if(name=="parallelNs") model.parallelNs = value;
+        else if(name=="fftNs") model.fftNs = value;
+        else throw SRRenderError("BadCostModelFile","Unknown cost model coefficient '"+name+"' in: "+path);
+    }
+    if(!in.eof()) throw SRRenderError("BadCostModelFile","Malformed cost model file: "+path);
+    return model;
+}
+
+CostModel CostModel::global()
+{
+    std::lock_guard<std::mutex> lock(global_mutex);
+    if(!global_model) {
+        const char *path = std::getenv("SRRENDER_COST_MODEL");
+        global_model.reset(new CostModel(path && *path ? load(path) : CostModel()));
+    }
+    return *global_model;
+}
+
+void CostModel::set_global(const CostModel &model)
+{
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_model.reset(new CostModel(model));
+}
+
+} /* namespace srrender */
@@ -0,0 +1,386 @@
+/** @file Kernels.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The scalar and SIMD rendering kernels and their runtime ISA dispatch.
+ *
+ * This file must be compiled without floating point contraction (-ffp-contract=off) so the scalar loops are not
+ * fused into FMA instructions, which would break bit-identity with the vector kernels.
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "SRRender/Kernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SRRENDER_X86_KERNELS 1
+#ifndef __clang__ //GCC 12 warns inside the AVX-512 intrinsics, which leave some lanes undefined on purpose
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+#define SRRENDER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SRRENDER_X86_KERNELS 0
+#endif
+
+namespace srrender {
+namespace kernels {
+
+namespace {
+
+/* Parameters of the piecewise Taylor expansion of erf used by erf_array */
+template<class FloatT> struct ErfParams;
+template<> struct ErfParams<float> {
+    static const int Intervals = 32;
+    static const int Degree = 6;
+    static double xmax() { return 4.; } //erf(4) rounds to 1 in float
+};
+template<> struct ErfParams<double> {
+    static const int Intervals = 64;
+    static const int Degree = 9;
+    static double xmax() { return 6.; } //erf(6) rounds to 1 in double
+};
+
+/* Taylor coefficients of erf about the midpoint of each interval.
+ * coef[k*M+i] is the coefficient of u^k on interval i where u = |x| - (i+0.5)*h
+ * Using d^k/dx^k erf(x) = 2/sqrt(pi) * (-1)^(k-1) * H_{k-1}(x) * exp(-x^2) for the Hermite polynomials H_n.
+ */
+template<class FloatT>
+struct ErfTable {
+    static const int M = ErfParams<FloatT>::Intervals;
+    static const int K = ErfParams<FloatT>::Degree;
+    FloatT xmax;
+    FloatT h;
+    FloatT invH;
+    FloatT coef[(K+1)*M];
+
+    ErfTable()
+    {
+        xmax = static_cast<FloatT>(ErfParams<FloatT>::xmax());
+        h = static_cast<FloatT>(ErfParams<FloatT>::xmax()/M);
+        invH = static_cast<FloatT>(M/ErfParams<FloatT>::xmax());
+        const long double two_over_sqrtpi = 1.1283791670955125738961589031215452L;
+        for(int i=0; i<M; i++) {
+            long double m = (i+0.5L)*h;
+            long double g = two_over_sqrtpi*std::exp(-m*m);
+            long double hermite_prev = 0, hermite = 1; //H_{-1} (unused), H_0
+            long double factorial = 1;
+            coef[i] = static_cast<FloatT>(std::erf(m));
+            for(int k=1; k<=K; k++) {
+                factorial *= k;
+                long double sign = (k%2) ? 1 : -1;
+                coef[k*M+i] = static_cast<FloatT>(sign*g*hermite/factorial);
+                long double hermite_next = 2*m*hermite - 2*(k-1)*hermite_prev;
+                hermite_prev = hermite;
+                hermite = hermite_next;
+            }
+        }
+    }
+};
+
+template<class FloatT>
+const ErfTable<FloatT>& erf_table()
+{
+    static const ErfTable<FloatT> table;
+    return table;
+}
+
+template<class FloatT>
+inline FloatT erf_scalar(const ErfTable<FloatT> &t, FloatT x)
+{
+    const int M = ErfTable<FloatT>::M;
+    const int K = ErfTable<FloatT>::K;
+    FloatT ax = std::fabs(x);
+    ax = ax < t.xmax ? ax : t.xmax; //Same semantics as SIMD min: NaN maps to xmax
+    int i = static_cast<int>(ax*t.invH);
+    i = i < M-1 ? i : M-1;
+    FloatT u = ax - (static_cast<FloatT>(i)+static_cast<FloatT>(0.5))*t.h;
+    FloatT p = t.coef[K*M+i];
+    for(int k=K-1; k>=0; k--) p = p*u + t.coef[k*M+i];
+    return std::copysign(p,x);
+}
+
+template<class FloatT>
+void erf_array_scalar(std::size_t n, const FloatT *x, FloatT *out)
+{
+    const ErfTable<FloatT> &t = erf_table<FloatT>();
+    for(std::size_t j=0; j<n; j++) out[j] = erf_scalar(t,x[j]);
+}
+
+template<class FloatT>
+void splat_rank1_scalar(FloatT *im, std::size_t ld, std::size_t nx, std::size_t ny, FloatT I, const FloatT *xs, const FloatT *ys)
+{
+    for(std::size_t x=0; x<nx; x++) {
+        FloatT w = I*xs[x];
+        FloatT *col = im + x*ld;
+        for(std::size_t y=0; y<ny; y++) col[y] += w*ys[y];
+    }
+}
+
+#if SRRENDER_X86_KERNELS
+/* AVX2 kernels */
+SRRENDER_TARGET("avx2")
+void splat_rank1_avx2(float *im, std::size_t ld, std::size_t nx, std::size_t ny, float I, const float *xs, const float *ys)
+{
+    for(std::size_t x=0; x<nx; x++) {
+        float w = I*xs[x];
+        __m256 wv = _mm256_set1_ps(w);
+        float *col = im + x*ld;
+        std::size_t y=0;
+        for(; y+8<=ny; y+=8)
+            _mm256_storeu_ps(col+y, _mm256_add_ps(_mm256_loadu_ps(col+y), _mm256_mul_ps(wv, _mm256_loadu_ps(ys+y))));
+        for(; y<ny; y++) col[y] += w*ys[y];
+    }
+}
+
+SRRENDER_TARGET("avx2")
+void splat_rank1_avx2(double *im, std::size_t ld, std::size_t nx, std::size_t ny, double I, const double *xs, const double *ys)
+{
+    for(std::size_t x=0; x<nx; x++) {
+        double w = I*xs[x];
+        __m256d wv = _mm256_set1_pd(w);
+        double *col = im + x*ld;
+        std::size_t y=0;
+        for(; y+4<=ny; y+=4)
+            _mm256_storeu_pd(col+y, _mm256_add_pd(_mm256_loadu_pd(col+y), _mm256_mul_pd(wv, _mm256_loadu_pd(ys+y))));
+        for(; y<ny; y++) col[y] += w*ys[y];
+    }
+}
+
+SRRENDER_TARGET("avx2")
+void erf_array_avx2(std::size_t n, const float *x, float *out)
+{
+    using TableT = ErfTable<float>;
+    const TableT &t = erf_table<float>();
+    const __m256 signmask = _mm256_set1_ps(-0.0f);
+    const __m256 xmax = _mm256_set1_ps(t.xmax);
+    const __m256 invH = _mm256_set1_ps(t.invH);
+    const __m256 h = _mm256_set1_ps(t.h);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i imax = _mm256_set1_epi32(TableT::M-1);
+    std::size_t j=0;
+    for(; j+8<=n; j+=8) {
+        __m256 xv = _mm256_loadu_ps(x+j);
+        __m256 ax = _mm256_min_ps(_mm256_andnot_ps(signmask, xv), xmax);
+        __m256i i = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(ax, invH)), imax);
+        __m256 u = _mm256_sub_ps(ax, _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(i), half), h));
+        __m256 p = _mm256_i32gather_ps(t.coef+TableT::K*TableT::M, i, 4);
+        for(int k=TableT::K-1; k>=0; k--)
+            p = _mm256_add_ps(_mm256_mul_ps(p,u), _mm256_i32gather_ps(t.coef+k*TableT::M, i, 4));
+        p = _mm256_or_ps(_mm256_andnot_ps(signmask, p), _mm256_and_ps(signmask, xv));
+        _mm256_storeu_ps(out+j, p);
+    }
+    for(; j<n; j++) out[j] = erf_scalar(t,x[j]);
+}
+
+SRRENDER_TARGET("avx2")
+void erf_array_avx2(std::size_t n, const double *x, double *out)
+{
+    using TableT = ErfTable<double>;
+    const TableT &t = erf_table<double>();
+    const __m256d signmask = _mm256_set1_pd(-0.0);
+    const __m256d xmax = _mm256_set1_pd(t.xmax);
+    const __m256d invH = _mm256_set1_pd(t.invH);
+    const __m256d h = _mm256_set1_pd(t.h);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m128i imax = _mm_set1_epi32(TableT::M-1);
+    std::size_t j=0;
+    for(; j+4<=n; j+=4) {
+        __m256d xv = _mm256_loadu_pd(x+j);
+        __m256d ax = _mm256_min_pd(_mm256_andnot_pd(signmask, xv), xmax);
+        __m128i i = _mm_min_epi32(_mm256_cvttpd_epi32(_mm256_mul_pd(ax, invH)), imax);
+        __m256d u = _mm256_sub_pd(ax, _mm256_mul_pd(_mm256_add_pd(_mm256_cvtepi32_pd(i), half), h));
+        __m256d p = _mm256_i32gather_pd(t.coef+TableT::K*TableT::M, i, 8);
+        for(int k=TableT::K-1; k>=0; k--)
+            p = _mm256_add_pd(_mm256_mul_pd(p,u), _mm256_i32gather_pd(t.coef+k*TableT::M, i, 8));
+        p = _mm256_or_pd(_mm256_andnot_pd(signmask, p), _mm256_and_pd(signmask, xv));
+        _mm256_storeu_pd(out+j, p);
+    }
+    for(; j<n; j++) out[j] = erf_scalar(t,x[j]);
+}
+
+/* AVX-512 kernels.  Tails are handled with masked loads and stores. */
+SRRENDER_TARGET("avx512f")
+void splat_rank1_avx512(float *im, std::size_t ld, std::size_t nx, std::size_t ny, float I, const float *xs, const float *ys)
+{
+    __mmask16 tail = static_cast<__mmask16>((1u<<(ny%16))-1);
+    for(std::size_t x=0; x<nx; x++) {
+        __m512 wv = _mm512_set1_ps(I*xs[x]);
+        float *col = im + x*ld;
+        std::size_t y=0;
+        for(; y+16<=ny; y+=16)
+            _mm512_storeu_ps(col+y, _mm512_add_ps(_mm512_loadu_ps(col+y), _mm512_mul_ps(wv, _mm512_loadu_ps(ys+y))));
+        if(tail) {
+            __m512 c = _mm512_add_ps(_mm512_maskz_loadu_ps(tail, col+y), _mm512_mul_ps(wv, _mm512_maskz_loadu_ps(tail, ys+y)));
+            _mm512_mask_storeu_ps(col+y, tail, c);
+        }
+    }
+}
+
+SRRENDER_TARGET("avx512f")
+void splat_rank1_avx512(double *im, std::size_t ld, std::size_t nx, std::size_t ny, double I, const double *xs, const double *ys)
+{
+    __mmask8 tail = static_cast<__mmask8>((1u<<(ny%8))-1);
+    for(std::size_t x=0; x<nx; x++) {
+        __m512d wv = _mm512_set1_pd(I*xs[x]);
+        double *col = im + x*ld;
+        std::size_t y=0;
+        for(; y+8<=ny; y+=8)
+            _mm512_storeu_pd(col+y, _mm512_add_pd(_mm512_loadu_pd(col+y), _mm512_mul_pd(wv, _mm512_loadu_pd(ys+y))));
+        if(tail) {
+            __m512d c = _mm512_add_pd(_mm512_maskz_loadu_pd(tail, col+y), _mm512_mul_pd(wv, _mm512_maskz_loadu_pd(tail, ys+y)));
+            _mm512_mask_storeu_pd(col+y, tail, c);
+        }
+    }
+}
+
+SRRENDER_TARGET("avx512f")
+void erf_array_avx512(std::size_t n, const float *x, float *out)
+{
+    using TableT = ErfTable<float>;
+    const TableT &t = erf_table<float>();
+    const __m512i signmask = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+    const __m512 xmax = _mm512_set1_ps(t.xmax);
+    const __m512 invH = _mm512_set1_ps(t.invH);
+    const __m512 h = _mm512_set1_ps(t.h);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512i imax = _mm512_set1_epi32(TableT::M-1);
+    std::size_t j=0;
+    for(; j<n; j+=16) {
+        __mmask16 mask = n-j>=16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u<<(n-j))-1);
+        __m512i xi = _mm512_castps_si512(_mm512_maskz_loadu_ps(mask, x+j));
+        __m512 ax = _mm512_min_ps(_mm512_castsi512_ps(_mm512_andnot_si512(signmask, xi)), xmax);
+        __m512i i = _mm512_min_epi32(_mm512_cvttps_epi32(_mm512_mul_ps(ax, invH)), imax);
+        __m512 u = _mm512_sub_ps(ax, _mm512_mul_ps(_mm512_add_ps(_mm512_cvtepi32_ps(i), half), h));
+        __m512 p = _mm512_i32gather_ps(i, t.coef+TableT::K*TableT::M, 4);
+        for(int k=TableT::K-1; k>=0; k--)
+            p = _mm512_add_ps(_mm512_mul_ps(p,u), _mm512_i32gather_ps(i, t.coef+k*TableT::M, 4));
+        __m512i pi = _mm512_or_si512(_mm512_andnot_si512(signmask, _mm512_castps_si512(p)), _mm512_and_si512(signmask, xi));
+        _mm512_mask_storeu_ps(out+j, mask, _mm512_castsi512_ps(pi));
+    }
+}
+
+SRRENDER_TARGET("avx512f")
+void erf_array_avx512(std::size_t n, const double *x, double *out)
+{
+    using TableT = ErfTable<double>;
+    const TableT &t = erf_table<double>();
+    const __m512i signmask = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull));
+    const __m512d xmax = _mm512_set1_pd(t.xmax);
+    const __m512d invH = _mm512_set1_pd(t.invH);
+    const __m512d h = _mm512_set1_pd(t.h);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m256i imax = _mm256_set1_epi32(TableT::M-1);
+    std::size_t j=0;
+    for(; j<n; j+=8) {
+        __mmask8 mask = n-j>=8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u<<(n-j))-1);
+        __m512i xi = _mm512_castpd_si512(_mm512_maskz_loadu_pd(mask, x+j));
+        __m512d ax = _mm512_min_pd(_mm512_castsi512_pd(_mm512_andnot_si512(signmask, xi)), xmax);
+        __m256i i = _mm256_min_epi32(_mm512_cvttpd_epi32(_mm512_mul_pd(ax, invH)), imax);
+        __m512d u = _mm512_sub_pd(ax, _mm512_mul_pd(_mm512_add_pd(_mm512_cvtepi32_pd(i), half), h));
+        __m512d p = _mm512_i32gather_pd(i, t.coef+TableT::K*TableT::M, 8);
+        for(int k=TableT::K-1; k>=0; k--)
+            p = _mm512_add_pd(_mm512_mul_pd(p,u), _mm512_i32gather_pd(i, t.coef+k*TableT::M, 8));
+        __m512i pi = _mm512_or_si512(_mm512_andnot_si512(signmask, _mm512_castpd_si512(p)), _mm512_and_si512(signmask, xi));
+        _mm512_mask_storeu_pd(out+j, mask, _mm512_castsi512_pd(pi));
+    }
+}
+#endif /* SRRENDER_X86_KERNELS */
+
+ISA detect_isa()
+{
+    ISA isa = ISA::Scalar;
+    if(isa_supported(ISA::AVX512)) isa = ISA::AVX512;
+    else if(isa_supported(ISA::AVX2)) isa = ISA::AVX2;
+    const char *limit = std::getenv("SRRENDER_ISA");
+    if(limit) {
+        if(!std::strcmp(limit,"scalar")) isa = ISA::Scalar;
+        else if(!std::strcmp(limit,"avx2") && isa==ISA::AVX512) isa = ISA::AVX2;
+    }
+    return isa;
+}
+
+} /* namespace */
+
+const char* isa_name(ISA isa)
+{
+    switch(isa) {
+        case ISA::AVX2: return "avx2";
+        case ISA::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+bool isa_supported(ISA isa)
+{
+#if SRRENDER_X86_KERNELS
+    __builtin_cpu_init();
+    switch(isa) {
+        case ISA::AVX2: return __builtin_cpu_supports("avx2");
+        case ISA::AVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+#else
+    return isa==ISA::Scalar;
+#endif
+}
+
+ISA active_isa()
+{
+    static const ISA isa = detect_isa();
+    return isa;
+}
+
+template<class FloatT>
+void splat_rank1(FloatT *im, std::size_t ld, std::size_t nx, std::size_t ny, FloatT I, const FloatT *xs, const FloatT *ys)
+{
+    splat_rank1(active_isa(), im, ld, nx, ny, I, xs, ys);
+}
+
+template<class FloatT>
+void splat_rank1(ISA isa, FloatT *im, std::size_t ld, std::size_t nx, std::size_t ny, FloatT I, const FloatT *xs, const FloatT *ys)
+{
+#if SRRENDER_X86_KERNELS
+    switch(isa) {
+        case ISA::AVX512: return splat_rank1_avx512(im, ld, nx, ny, I, xs, ys);
+        case ISA::AVX2: return splat_rank1_avx2(im, ld, nx, ny, I, xs, ys);
+        default: break;
+    }
+#endif
+    splat_rank1_scalar(im, ld, nx, ny, I, xs, ys);
+}
+
+template<class FloatT>
+void erf_array(std::size_t n, const FloatT *x, FloatT *out)
+{
+    erf_array(active_isa(), n, x, out);
+}
+
+template<class FloatT>
+void erf_array(ISA isa, std::size_t n, const FloatT *x, FloatT *out)
+{
+#if SRRENDER_X86_KERNELS
+    switch(isa) {
+        case ISA::AVX512: return erf_array_avx512(n, x, out);
+        case ISA::AVX2: return erf_array_avx2(n, x, out);
+        default: break;
+    }
+#endif
+    erf_array_scalar(n, x, out);
+}
+
+/* Explicit Template Instantiation */
+template void splat_rank1<float>(float*, std::size_t, std::size_t, std::size_t, float, const float*, const float*);
+template void splat_rank1<double>(double*, std::size_t, std::size_t, std::size_t, double, const double*, const double*);
+template void splat_rank1<float>(ISA, float*, std::size_t, std::size_t, std::size_t, float, const float*, const float*);
+template void splat_rank1<double>(ISA, double*, std::size_t, std::size_t, std::size_t, double, const double*, const double*);
+template void erf_array<float>(std::size_t, const float*, float*);
+template void erf_array<double>(std::size_t, const double*, double*);
+template void erf_array<float>(ISA, std::size_t, const float*, float*);
+template void erf_array<double>(ISA, std::size_t, const double*, double*);
+
+} /* namespace srrender::kernels */
+} /* namespace srrender */
@@ -9,11 +9,13 @@
 
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <memory>
 #include <thread>
-#include <omp.h>
 
 #include "MexIFace/MexIFace.h"
 #include "SRRender/SRRender.h"
+#include "SRRender/SRAsyncRender2D.h"
 
 template<class FloatT=float, class IndexT=uint32_t>
 class SRRender2D_IFace : public mexiface::MexIFace,
@@ -30,19 +32,53 @@ private:
     //Exposed static methods
     void objRenderHist();
     void objRenderGauss();
+    void objRenderGaussBudget();
     void objRenderHistMovie();
     void objRenderGaussMovie();
+    void objRenderHistMovieWindowed();
+    void objRenderGaussMovieWindowed();
+    void objRenderHistChannels();
+    void objRenderGaussChannels();
+    void objSetRenderOptions();
+    void objRenderAsyncStart();
+    void objRenderAsyncProgress();
+    void objRenderAsyncSnapshot();
+    void objRenderAsyncCancel();
+    void objRenderAsyncWait();
+
+    //Threading options for renders made through this interface.  Defaults to one thread per hardware thread.
+    srrender::RenderOptions options;
+
+    //Background renders started with renderAsyncStart, by id
+    using AsyncRenderT = srrender::SRAsyncRender2D<FloatT,IndexT>;
+    using AsyncMapT = std::map<IndexT,std::unique_ptr<AsyncRenderT>>;
+    AsyncMapT async_renders;
+    IndexT next_async_id = 1;
+    typename AsyncMapT::iterator getAsyncRender();
+
+    template<class RenderFuncT> void renderWithStats(RenderFuncT render);
 };
 
 template<class FloatT, class IndexT>
 SRRender2D_IFace<FloatT,IndexT>::SRRender2D_IFace()
 {
-    omp_set_num_threads(std::thread::hardware_concurrency());
+    options.threads = std::thread::hardware_concurrency();
 
     staticmethodmap["renderHist"] = std::bind(&SRRender2D_IFace::objRenderHist, this);
     staticmethodmap["renderGauss"] = std::bind(&SRRender2D_IFace::objRenderGauss, this);
+    staticmethodmap["renderGaussBudget"] = std::bind(&SRRender2D_IFace::objRenderGaussBudget, this);
     staticmethodmap["renderHistMovie"] = std::bind(&SRRender2D_IFace::objRenderHistMovie, this);
     staticmethodmap["renderGaussMovie"] = std::bind(&SRRender2D_IFace::objRenderGaussMovie, this);
+    staticmethodmap["renderHistMovieWindowed"] = std::bind(&SRRender2D_IFace::objRenderHistMovieWindowed, this);
+    staticmethodmap["renderGaussMovieWindowed"] = std::bind(&SRRender2D_IFace::objRenderGaussMovieWindowed, this);
+    staticmethodmap["renderHistChannels"] = std::bind(&SRRender2D_IFace::objRenderHistChannels, this);
+    staticmethodmap["renderGaussChannels"] = std::bind(&SRRender2D_IFace::objRenderGaussChannels, this);
+    staticmethodmap["setRenderOptions"] = std::bind(&SRRender2D_IFace::objSetRenderOptions, this);
+    staticmethodmap["renderAsyncStart"] = std::bind(&SRRender2D_IFace::objRenderAsyncStart, this);
+    staticmethodmap["renderAsyncProgress"] = std::bind(&SRRender2D_IFace::objRenderAsyncProgress, this);
+    staticmethodmap["renderAsyncSnapshot"] = std::bind(&SRRender2D_IFace::objRenderAsyncSnapshot, this);
+    staticmethodmap["renderAsyncCancel"] = std::bind(&SRRender2D_IFace::objRenderAsyncCancel, this);
+    staticmethodmap["renderAsyncWait"] = std::bind(&SRRender2D_IFace::objRenderAsyncWait, this);
 }
 
 template<class FloatT, class IndexT>
@@ -52,6 +88,26 @@ void SRRender2D_IFace<FloatT,IndexT>::objConstruct()
     this->outputHandle(new srrender::SRRender2D<FloatT,IndexT>());
 }
 
+/* Call render() with the interface's RenderOptions, and if an output is requested, return the RenderStats for the
+ * render as a struct.  The stats are all zero unless the library was built with OPT_STATS.
+ */
+template<class FloatT, class IndexT>
+template<class RenderFuncT>
+void SRRender2D_IFace<FloatT,IndexT>::renderWithStats(RenderFuncT render)
+{
+    srrender::RenderOptionsScope optionsScope(options);
+    if(nlhs==0) {
+        render();
+        return;
+    }
+    srrender::RenderStats stats;
+    {
+        srrender::RenderStatsScope scope(stats);
+        render();
+    }
+    outputStatsToStruct(stats.get_stats());
+}
+
 template<class FloatT, class IndexT>
 void SRRender2D_IFace<FloatT,IndexT>::objRenderHist()
 {
@@ -60,12 +116,14 @@ void SRRender2D_IFace<FloatT,IndexT>::objRenderHist()
     //                                     for the images generated.  This should be exact to the boundaries of im.
     // [in/out] im: a image with arbitrary size but should match aspect ratio of the internal size.  This
     //          image will be modified in-place.
+    // [out] stats: (optional) struct of RenderStats for the render
 
-    checkNumArgs(0,3);
+    checkMinNumArgs(0,3);
+    checkMaxNumArgs(1,3);
     auto points = getMat<FloatT>();
     auto roi = getVec<FloatT>();
     auto im = getMat<FloatT>();
-    obj->renderHist(points,roi,im);
+    renderWithStats([&]{ obj->renderHist(points,roi,im); });
 }
 
 template<class FloatT, class IndexT>
@@ -77,13 +135,39 @@ void SRRender2D_IFace<FloatT,IndexT>::objRenderGauss()
     // [in] sigmaAccuracy: floating point >0.  Gives accuracy at which gaussians will be rendered
     // [in/out] im: a image with arbitrary size but should match aspect ratio of the internal size.  This
     //          image will be modified in-place.
+    // [out] stats: (optional) struct of RenderStats for the render
 
-    checkNumArgs(0,4);
+    checkMinNumArgs(0,4);
+    checkMaxNumArgs(1,4);
     auto points = getMat<FloatT>();
     auto roi = getVec<FloatT>();
     auto sigmaAccuracy = getAsFloat<FloatT>();
     auto im = getMat<FloatT>();
-    obj->renderGauss(points,roi,im, sigmaAccuracy);
+    renderWithStats([&]{ obj->renderGauss(points,roi,im, sigmaAccuracy); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderGaussBudget()
+{
+    // [in] points: mat with n rows and 5 (or more) columns [I, x, y, sigma_x, sigma_y]
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest that
+    //                                     for the images generated.  This should be exact to the boundaries of im.
+    // [in] tolerance: floating point >0.  Largest error each emitter may add to any pixel by truncating its stencil
+    // [in] relative: nonzero if tolerance is a fraction of the brightest emitter peak, zero if in intensity units
+    // [in/out] im: a image with arbitrary size but should match aspect ratio of the internal size.  This
+    //          image will be modified in-place.
+    // [out] stats: (optional) struct of RenderStats for the render
+
+    checkMinNumArgs(0,5);
+    checkMaxNumArgs(1,5);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    using ErrorBudgetT = typename srrender::SRRender2D<FloatT,IndexT>::ErrorBudget;
+    ErrorBudgetT budget;
+    budget.tolerance = getAsFloat<FloatT>();
+    budget.kind = getAsUnsigned<IndexT>() ? ErrorBudgetT::Kind::Relative : ErrorBudgetT::Kind::Absolute;
+    auto im = getMat<FloatT>();
+    renderWithStats([&]{ obj->renderGauss(points,roi,im,budget); });
 }
 
 template<class FloatT, class IndexT>
@@ -95,12 +179,14 @@ void SRRender2D_IFace<FloatT,IndexT>::objRenderHistMovie()
     //                                     for the images generated.  This should be exact to the boundaries of im.
     // [in/out] im: a image sequence (movie) with arbitrary size but should match aspect ratio of the internal size.  This
     //          image will be modified in-place.  The number of frames should match the frame indexs from points
+    // [out] stats: (optional) struct of RenderStats for the render
 
-    checkNumArgs(0,3);
+    checkMinNumArgs(0,3);
+    checkMaxNumArgs(1,3);
     auto points = getMat<FloatT>();
     auto roi = getVec<FloatT>();
     auto im = getCube<FloatT>();
-    obj->renderHistMovie(points,roi,im);
+    renderWithStats([&]{ obj->renderHistMovie(points,roi,im); });
 }
 
 
@@ -113,12 +199,211 @@ void SRRender2D_IFace<FloatT,IndexT>::objRenderGaussMovie()
     //                                     for the images generated.  This should be exact to the boundaries of im.
     // [in/out] im: a image sequence (movie) with arbitrary size but should match aspect ratio of the internal size.  This
     //          image will be modified in-place.  The number of frames should match the frame indexs from points
+    // [out] stats: (optional) struct of RenderStats for the render
 
-    checkNumArgs(0,3);
+    checkMinNumArgs(0,3);
+    checkMaxNumArgs(1,3);
     auto points = getMat<FloatT>();
     auto roi = getVec<FloatT>();
     auto im = getCube<FloatT>();
-    obj->renderGaussMovie(points,roi,im);
+    renderWithStats([&]{ obj->renderGaussMovie(points,roi,im); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderHistMovieWindowed()
+{
+    // [in] points: mat with n rows and 6 (or more) columns [I, x, y, sigma_x, sigma_y, frameIdx]
+    //              frame indexs are 0-based.
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest that
+    //                                     for the images generated.  This should be exact to the boundaries of im.
+    // [in] window: number of input frames summed into each output frame
+    // [in] stride: number of input frames between the starts of consecutive windows
+    // [in/out] im: a image sequence (movie) with arbitrary size but should match aspect ratio of the internal size.  This
+    //          image will be modified in-place.  Output frame k is the sum of input frames [k*stride, k*stride+window).
+    // [out] stats: (optional) struct of RenderStats for the render
+
+    checkMinNumArgs(0,5);
+    checkMaxNumArgs(1,5);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    auto window = getAsUnsigned<IndexT>();
+    auto stride = getAsUnsigned<IndexT>();
+    auto im = getCube<FloatT>();
+    renderWithStats([&]{ obj->renderHistMovieWindowed(points,roi,im,window,stride); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderGaussMovieWindowed()
+{
+    // [in] points: mat with n rows and 6 (or more) columns [I, x, y, sigma_x, sigma_y, frameIdx]
+    //              frame indexs are 0-based.
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest that
+    //                                     for the images generated.  This should be exact to the boundaries of im.
+    // [in] window: number of input frames summed into each output frame
+    // [in] stride: number of input frames between the starts of consecutive windows
+    // [in] sigmaAccuracy: floating point >0.  Gives accuracy at which gaussians will be rendered
+    // [in/out] im: a image sequence (movie) with arbitrary size but should match aspect ratio of the internal size.  This
+    //          image will be modified in-place.  Output frame k is the sum of input frames [k*stride, k*stride+window).
+    // [out] stats: (optional) struct of RenderStats for the render
+
+    checkMinNumArgs(0,6);
+    checkMaxNumArgs(1,6);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    auto window = getAsUnsigned<IndexT>();
+    auto stride = getAsUnsigned<IndexT>();
+    auto sigmaAccuracy = getAsFloat<FloatT>();
+    auto im = getCube<FloatT>();
+    renderWithStats([&]{ obj->renderGaussMovieWindowed(points,roi,im,window,stride,sigmaAccuracy); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderHistChannels()
+{
+    // [in] points: mat with n rows and 6 (or more) columns [I, x, y, sigma_x, sigma_y, channelIdx]
+    //              channel indexs are 0-based.  sigma_x and sigma_y are ignored but must be included,
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest that
+    //                                     for the images generated.  This should be exact to the boundaries of im.
+    // [in] weights: mat with one row per channel and one column per slice of im.  Each point adds I*weights(c,k)
+    //               to slice k, e.g., an nChannels x 3 matrix of colors for an RGB image.
+    // [in/out] im: a multi-channel image with one slice per column of weights.  This image will be modified in-place.
+    // [out] stats: (optional) struct of RenderStats for the render
+
+    checkMinNumArgs(0,4);
+    checkMaxNumArgs(1,4);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    auto weights = getMat<FloatT>();
+    auto im = getCube<FloatT>();
+    renderWithStats([&]{ obj->renderHistChannels(points,roi,im,weights); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderGaussChannels()
+{
+    // [in] points: mat with n rows and 6 (or more) columns [I, x, y, sigma_x, sigma_y, channelIdx]
+    //              channel indexs are 0-based.
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest that
+    //                                     for the images generated.  This should be exact to the boundaries of im.
+    // [in] weights: mat with one row per channel and one column per slice of im.  Each point adds I*weights(c,k)
+    //               to slice k, e.g., an nChannels x 3 matrix of colors for an RGB image.
+    // [in] sigmaAccuracy: floating point >0.  Gives accuracy at which gaussians will be rendered
+    // [in/out] im: a multi-channel image with one slice per column of weights.  This image will be modified in-place.
+    // [out] stats: (optional) struct of RenderStats for the render
+
+    checkMinNumArgs(0,5);
+    checkMaxNumArgs(1,5);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    auto weights = getMat<FloatT>();
+    auto sigmaAccuracy = getAsFloat<FloatT>();
+    auto im = getCube<FloatT>();
+    renderWithStats([&]{ obj->renderGaussChannels(points,roi,im,weights,sigmaAccuracy); });
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objSetRenderOptions()
+{
+    // [in] threads: number of render threads, or 0 for one per hardware thread
+    // [in] affinity: thread binding 0=OpenMP default (OMP_PROC_BIND), 1=close, 2=spread across sockets
+    // [in] firstTouch: nonzero to have render threads first-touch the image regions they write (for NUMA machines)
+    // Options apply only to renders made through this interface.  OpenMP settings of the process are not changed.
+
+    checkNumArgs(0,3);
+    auto threads = getAsUnsigned<IndexT>();
+    auto affinity = getAsUnsigned<IndexT>();
+    auto firstTouch = getAsUnsigned<IndexT>();
+    if(affinity>2) throw srrender::SRRenderError("BadAffinity","Affinity must be 0 (default), 1 (close) or 2 (spread)");
+    options.threads = threads>0 ? static_cast<int>(threads) : static_cast<int>(std::thread::hardware_concurrency());
+    options.affinity = static_cast<srrender::RenderOptions::Affinity>(affinity);
+    options.firstTouch = firstTouch!=0;
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderAsyncStart()
+{
+    // [in] points: mat with n rows and 3 [I, x, y] or 5 (or more) columns [I, x, y, sigma_x, sigma_y].  Points are copied.
+    // [in] roi=[xmin, xmax, ymin, ymax] - 4-element vector giving effective region of interest for the image.
+    // [in] imSize=[sizeY, sizeX] - size of the image in pixels
+    // [in] gauss: nonzero to render gaussians, zero for a histogram
+    // [in] sigmaAccuracy: floating point >0.  Gives accuracy at which gaussians will be rendered
+    // [out] id: handle for the other renderAsync methods.  Every render must be finished with
+    //           renderAsyncWait or renderAsyncCancel to release it.
+    // The render runs in the background with the current render options and returns immediately.
+
+    checkNumArgs(1,5);
+    auto points = getMat<FloatT>();
+    auto roi = getVec<FloatT>();
+    auto imSize = getVec<FloatT>();
+    auto gauss = getAsUnsigned<IndexT>();
+    auto sigmaAccuracy = getAsFloat<FloatT>();
+    if(imSize.n_elem!=2) throw srrender::SRRenderError("BadImageSize","Image size must be [sizeY, sizeX]");
+    auto mode = gauss ? AsyncRenderT::Mode::Gauss : AsyncRenderT::Mode::Hist;
+    srrender::RenderOptionsScope optionsScope(options);
+    IndexT id = next_async_id++;
+    async_renders[id].reset(new AsyncRenderT(points, roi, static_cast<IndexT>(imSize(1)), static_cast<IndexT>(imSize(0)),
+                                             mode, sigmaAccuracy));
+    output(id);
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderAsyncProgress()
+{
+    // [in] id: render handle from renderAsyncStart
+    // [out] progress: fraction of the points rendered so far
+    // [out] done: true if the render has stopped
+
+    checkMinNumArgs(1,1);
+    checkMaxNumArgs(2,1);
+    auto it = getAsyncRender();
+    output(it->second->progress());
+    if(nlhs>1) output(it->second->done());
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderAsyncSnapshot()
+{
+    // [in] id: render handle from renderAsyncStart
+    // [out] im: preview of the image from the points rendered so far, scaled to the intensity of the full render
+
+    checkNumArgs(1,1);
+    auto it = getAsyncRender();
+    output(it->second->snapshot());
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderAsyncCancel()
+{
+    // [in] id: render handle from renderAsyncStart.  The render is stopped and the handle released.
+
+    checkNumArgs(0,1);
+    auto it = getAsyncRender();
+    it->second->cancel();
+    async_renders.erase(it);
+}
+
+template<class FloatT, class IndexT>
+void SRRender2D_IFace<FloatT,IndexT>::objRenderAsyncWait()
+{
+    // [in] id: render handle from renderAsyncStart.  Blocks until the render is done and releases the handle.
+    // [out] im: the rendered image
+
+    checkNumArgs(1,1);
+    auto it = getAsyncRender();
+    std::unique_ptr<AsyncRenderT> render = std::move(it->second);
+    async_renders.erase(it);
+    render->wait();
+    output(render->snapshot());
+}
+
+template<class FloatT, class IndexT>
+typename SRRender2D_IFace<FloatT,IndexT>::AsyncMapT::iterator SRRender2D_IFace<FloatT,IndexT>::getAsyncRender()
+{
+    auto id = getAsUnsigned<IndexT>();
+    auto it = async_renders.find(id);
+    if(it==async_renders.end())
+        throw srrender::SRRenderError("BadAsyncId","No background render with id "+std::to_string(id));
+    return it;
 }
 
 #endif /* SRRENDER_SRRENDER_IFACE_H */
@@ -0,0 +1,36 @@
+/** @file RenderOptions.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definitions for RenderOptions.
+ */
+#include "SRRender/RenderOptions.h"
+
+namespace srrender {
+
+namespace {
+const RenderOptions default_options;
+thread_local const RenderOptions *active_options = nullptr;
+} /* namespace */
+
+RenderOptionsScope::RenderOptionsScope(const RenderOptions &options_) : options(options_), previous(active_options)
+{
+    active_options = &options;
+}
+
+RenderOptionsScope::~RenderOptionsScope()
+{
+    active_options = previous;
+}
+
+const RenderOptions& RenderOptionsScope::active()
+{
+    return active_options ? *active_options : default_options;
+}
+
+int RenderOptionsScope::threads()
+{
+    int threads = active().threads;
+    return threads>0 ? threads : omp_get_max_threads();
+}
+
+} /* namespace srrender */
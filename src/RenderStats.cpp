@@ -0,0 +1,50 @@
+/** @file RenderStats.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definitions for RenderStats.
+ */
+#include "SRRender/RenderStats.h"
+
+namespace srrender {
+
+namespace {
+thread_local RenderStats *active_stats = nullptr;
+} /* namespace */
+
+const bool RenderStats::Enabled;
+
+RenderStats::StatsT RenderStats::get_stats() const
+{
+    StatsT stats;
+    stats["enabled"] = Enabled;
+    stats["renders"] = renders;
+    stats["threads"] = threads;
+    stats["totalSeconds"] = totalSeconds;
+    stats["allocSeconds"] = allocSeconds;
+    stats["binSeconds"] = binSeconds;
+    stats["stencilSeconds"] = stencilSeconds;
+    stats["splatSeconds"] = splatSeconds;
+    stats["reduceSeconds"] = reduceSeconds;
+    stats["pointsRendered"] = pointsRendered;
+    stats["pointsClipped"] = pointsClipped;
+    stats["stencilPixels"] = stencilPixels;
+    stats["scratchBytes"] = scratchBytes;
+    return stats;
+}
+
+RenderStatsScope::RenderStatsScope(RenderStats &stats) : previous(active_stats)
+{
+    active_stats = &stats;
+}
+
+RenderStatsScope::~RenderStatsScope()
+{
+    active_stats = previous;
+}
+
+RenderStats* RenderStatsScope::active()
+{
+    return active_stats;
+}
+
+} /* namespace srrender */
@@ -0,0 +1,80 @@
+/** @file SRAccumulator2D.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definition and template Specializations for SRAccumulator2D.
+ */
+#include <omp.h>
+#include "SRRender/SRAccumulator2D.h"
+
+namespace srrender {
+
+template<class FloatT, class IdxT>
+const IdxT SRAccumulator2D<FloatT,IdxT>::ParallelBatchSize = 4096;
+
+template<class FloatT, class IdxT>
+SRAccumulator2D<FloatT,IdxT>::SRAccumulator2D(const VecT &roi_, IdxT pixelsX, IdxT pixelsY, Mode mode_, FloatT sigmaAccuracy)
+    : roi(roi_), mode(mode_), sigma_accuracy(sigmaAccuracy), image(pixelsY, pixelsX, arma::fill::zeros)
+{
+    check_geometry();
+}
+
+template<class FloatT, class IdxT>
+SRAccumulator2D<FloatT,IdxT>::SRAccumulator2D(const VecT &roi_, IdxT pixelsX, IdxT pixelsY, FloatT *imageMemory, Mode mode_,
+                                              FloatT sigmaAccuracy)
+    : roi(roi_), mode(mode_), sigma_accuracy(sigmaAccuracy), image(imageMemory, pixelsY, pixelsX, false, true)
+{
+    check_geometry();
+    image.zeros();
+}
+
+template<class FloatT, class IdxT>
+void SRAccumulator2D<FloatT,IdxT>::check_geometry() const
+{
+    if(roi.n_elem!=4 || !(roi(0)<roi(1)) || !(roi(2)<roi(3)))
+        throw SRRenderError("BadROI","ROI must be [xmin, xmax, ymin, ymax] with xmin<xmax and ymin<ymax");
+    if(image.n_elem==0) throw SRRenderError("BadImageSize","Image must have at least one pixel");
+    if(!(sigma_accuracy>0)) throw SRRenderError("BadSigmaAccuracy","sigmaAccuracy must be positive");
+}
+
+template<class FloatT, class IdxT>
+void SRAccumulator2D<FloatT,IdxT>::add(const EmitterVecT &points)
+{
+    add(typename RenderT::PointViewT(points));
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRAccumulator2D<FloatT,IdxT>::add(const PointView<PointFloatT> &points)
+{
+    if(points.n_points()==0) return;
+    if(mode==Mode::Hist) RenderT::checkPoints(points, {PointField::I, PointField::X, PointField::Y});
+    else RenderT::checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    bool parallel = points.n_points() >= ParallelBatchSize && RenderOptionsScope::threads() > 1;
+    if(mode==Mode::Hist) {
+        if(parallel) RenderT::renderHistTiled(points, roi, image, RenderT::DefaultTileSize, true);
+        else RenderT::renderHistSingle(points, roi, image);
+    } else {
+        if(parallel) RenderT::renderGaussTiled(points, roi, image, get_sigma_accuracy(), table.get(), RenderT::DefaultTileSize, true);
+        else RenderT::renderGaussSingle(points, roi, image, get_sigma_accuracy(), table.get());
+    }
+    num_points += points.n_points();
+    num_batches++;
+}
+
+template<class FloatT, class IdxT>
+void SRAccumulator2D<FloatT,IdxT>::reset()
+{
+    image.zeros();
+    num_points = 0;
+    num_batches = 0;
+}
+
+/* Explicit Template Instantiation */
+template class SRAccumulator2D<float>;
+template class SRAccumulator2D<double>;
+template void SRAccumulator2D<float>::add(const PointView<float>&);
+template void SRAccumulator2D<float>::add(const PointView<double>&);
+template void SRAccumulator2D<double>::add(const PointView<float>&);
+template void SRAccumulator2D<double>::add(const PointView<double>&);
+
+} /* namespace srrender */
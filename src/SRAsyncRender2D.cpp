@@ -0,0 +1,98 @@
+/** @file SRAsyncRender2D.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definition and template Specializations for SRAsyncRender2D.
+ */
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "SRRender/SRAsyncRender2D.h"
+
+namespace srrender {
+
+template<class FloatT, class IdxT>
+const IdxT SRAsyncRender2D<FloatT,IdxT>::FirstBatchSize = 4096;
+
+template<class FloatT, class IdxT>
+const IdxT SRAsyncRender2D<FloatT,IdxT>::MaxBatchSize = 1<<20;
+
+template<class FloatT, class IdxT>
+SRAsyncRender2D<FloatT,IdxT>::SRAsyncRender2D(const EmitterVecT &points_, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                              Mode mode, FloatT sigmaAccuracy, std::uint64_t seed_)
+    : points(points_), accumulator(roi, pixelsX, pixelsY, mode, sigmaAccuracy), options(RenderOptionsScope::active()),
+      seed(seed_), num_rendered(0), cancel_requested(false), finished(false)
+{
+    arma::uword nColumns = mode==Mode::Hist ? 3 : 5;
+    if(points.n_rows>0 && points.n_cols<nColumns)
+        throw SRRenderError("BadPoints", "Points must have at least "+std::to_string(nColumns)+" columns.");
+    worker = std::thread(&SRAsyncRender2D::run, this);
+}
+
+template<class FloatT, class IdxT>
+SRAsyncRender2D<FloatT,IdxT>::~SRAsyncRender2D()
+{
+    cancel();
+    if(worker.joinable()) worker.join();
+}
+
+template<class FloatT, class IdxT>
+double SRAsyncRender2D<FloatT,IdxT>::progress() const
+{
+    std::size_t N = get_num_points();
+    return N ? static_cast<double>(num_rendered)/N : 1.;
+}
+
+template<class FloatT, class IdxT>
+void SRAsyncRender2D<FloatT,IdxT>::wait()
+{
+    if(worker.joinable()) worker.join();
+    if(error) std::rethrow_exception(error);
+}
+
+template<class FloatT, class IdxT>
+typename SRAsyncRender2D<FloatT,IdxT>::ImageT SRAsyncRender2D<FloatT,IdxT>::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(image_mutex);
+    ImageT im = accumulator.get_image();
+    std::size_t rendered = num_rendered;
+    if(rendered>0 && rendered<get_num_points()) im *= static_cast<FloatT>(static_cast<double>(get_num_points())/rendered);
+    return im;
+}
+
+/* Render the points in a random order in doubling batches, so early snapshots are unbiased previews of the image */
+template<class FloatT, class IdxT>
+void SRAsyncRender2D<FloatT,IdxT>::run()
+{
+    RenderOptionsScope scope(options);
+    try {
+        std::size_t N = get_num_points();
+        std::vector<IdxT> order(N);
+        std::iota(order.begin(), order.end(), IdxT(0));
+        std::mt19937_64 generator(seed);
+        std::shuffle(order.begin(), order.end(), generator);
+        EmitterVecT batch;
+        std::size_t size = FirstBatchSize;
+        for(std::size_t begin=0; begin<N && !cancel_requested; begin+=size, size=std::min<std::size_t>(2*size, MaxBatchSize)) {
+            size = std::min(size, N-begin);
+            batch.set_size(size, points.n_cols);
+            for(arma::uword c=0; c<points.n_cols; c++) {
+                const FloatT *col = points.colptr(c);
+                FloatT *out = batch.colptr(c);
+                for(std::size_t k=0; k<size; k++) out[k] = col[order[begin+k]];
+            }
+            std::lock_guard<std::mutex> lock(image_mutex);
+            accumulator.add(batch);
+            num_rendered = begin+size;
+        }
+    } catch(...) {
+        error = std::current_exception();
+    }
+    finished = true;
+}
+
+/* Explicit Template Instantiation */
+template class SRAsyncRender2D<float>;
+template class SRAsyncRender2D<double>;
+
+} /* namespace srrender */
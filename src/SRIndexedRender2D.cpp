@@ -0,0 +1,176 @@
+/** @file SRIndexedRender2D.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definition and template Specializations for SRIndexedRender2D.
+ */
+#include <algorithm>
+#include <cmath>
+#include "SRRender/SRIndexedRender2D.h"
+
+namespace srrender {
+
+template<class FloatT, class IdxT>
+const IdxT SRIndexedRender2D<FloatT,IdxT>::DefaultPointsPerCell = 64;
+
+template<class FloatT, class IdxT>
+SRIndexedRender2D<FloatT,IdxT>::SRIndexedRender2D(const EmitterVecT &points, FloatT cellSize)
+{
+    build(typename RenderT::PointViewT(points), cellSize);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+SRIndexedRender2D<FloatT,IdxT>::SRIndexedRender2D(const PointView<PointFloatT> &points, FloatT cellSize)
+{
+    build(points, cellSize);
+}
+
+template<class FloatT, class IdxT>
+void SRIndexedRender2D<FloatT,IdxT>::renderHist(const VecT &roi, ImageT &im, Engine engine) const
+{
+    EmitterVecT visible;
+    gather(roi, im, 0, visible);
+    RenderT::renderHist(visible.n_rows==points.n_rows ? points : visible, roi, im, engine);
+}
+
+template<class FloatT, class IdxT>
+void SRIndexedRender2D<FloatT,IdxT>::renderGauss(const VecT &roi, ImageT &im, FloatT sigmaAccuracy, Engine engine) const
+{
+    if(!has_sigma()) throw SRRenderError("BadPoints","Indexed points have no sigmaX and sigmaY to render Gaussians.");
+    EmitterVecT visible;
+    gather(roi, im, sigmaAccuracy, visible);
+    RenderT::renderGauss(visible.n_rows==points.n_rows ? points : visible, roi, im, sigmaAccuracy, engine);
+}
+
+template<class FloatT, class IdxT>
+std::size_t SRIndexedRender2D<FloatT,IdxT>::count_visible(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy) const
+{
+    std::vector<std::pair<std::size_t,std::size_t>> runs;
+    visible_runs(roi, im, sigmaAccuracy, runs);
+    std::size_t count = 0;
+    for(auto &run: runs) count += run.second-run.first;
+    return count;
+}
+
+/* Copy the finite points of view into cell order with a counting sort over a grid covering their bounding box */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRIndexedRender2D<FloatT,IdxT>::build(const PointView<PointFloatT> &view, FloatT cellSize)
+{
+    RenderT::checkPoints(view, {PointField::I, PointField::X, PointField::Y});
+    if(!(cellSize>=0) || !std::isfinite(cellSize))
+        throw SRRenderError("BadCellSize","Cell size must be finite and non-negative, or 0 to choose automatically");
+    bool sigma = view.has(PointField::SigmaX) && view.has(PointField::SigmaY);
+    std::size_t N = view.n_points();
+    auto finite = [&](std::size_t n) { return std::isfinite(view.X(n)) && std::isfinite(view.Y(n)); };
+    std::size_t M = 0;
+    FloatT xmax = 0, ymax = 0;
+    for(std::size_t n=0; n<N; n++) if(finite(n)) {
+        FloatT X = view.X(n), Y = view.Y(n);
+        xmin = M ? std::min(xmin, X) : X;
+        xmax = M ? std::max(xmax, X) : X;
+        ymin = M ? std::min(ymin, Y) : Y;
+        ymax = M ? std::max(ymax, Y) : Y;
+        M++;
+    }
+    double width = xmax-xmin, height = ymax-ymin;
+    if(cellSize==0) {
+        double perCell = static_cast<double>(DefaultPointsPerCell)/std::max<std::size_t>(M,1);
+        cellSize = static_cast<FloatT>(width>0 && height>0 ? std::sqrt(width*height*perCell) : std::max(width,height)*perCell);
+        if(!(cellSize>0)) cellSize = 1;
+    }
+    //Limit the grid to a few cells per point, so tiny cell sizes cannot exhaust memory
+    auto nCells = [&](double size, double extent) { return std::floor(extent/size)+1; };
+    while(nCells(cellSize,width)*nCells(cellSize,height) > 4.*M+16) cellSize *= 2;
+    cell_size = cellSize;
+    cells_x = static_cast<IdxT>(nCells(cellSize,width));
+    cells_y = static_cast<IdxT>(nCells(cellSize,height));
+    auto cellOf = [&](std::size_t n) {
+        IdxT cx = std::min(cells_x-1, static_cast<IdxT>((view.X(n)-xmin)/cell_size));
+        IdxT cy = std::min(cells_y-1, static_cast<IdxT>((view.Y(n)-ymin)/cell_size));
+        return static_cast<std::size_t>(cx)*cells_y + cy;
+    };
+
+    cell_offsets.assign(static_cast<std::size_t>(cells_x)*cells_y+1, 0);
+    for(std::size_t n=0; n<N; n++) if(finite(n)) cell_offsets[cellOf(n)+1]++;
+    for(std::size_t c=1; c<cell_offsets.size(); c++) cell_offsets[c] += cell_offsets[c-1];
+    std::vector<std::size_t> next(cell_offsets.begin(), cell_offsets.end()-1);
+    points.set_size(M, sigma ? 5 : 3);
+    max_sigma_x = max_sigma_y = 0;
+    for(std::size_t n=0; n<N; n++) if(finite(n)) {
+        std::size_t k = next[cellOf(n)]++;
+        points(k,0) = view.I(n);
+        points(k,1) = view.X(n);
+        points(k,2) = view.Y(n);
+        if(!sigma) continue;
+        points(k,3) = view.sigmaX(n);
+        points(k,4) = view.sigmaY(n);
+        max_sigma_x = std::max<FloatT>(max_sigma_x, points(k,3));
+        max_sigma_y = std::max<FloatT>(max_sigma_y, points(k,4));
+    }
+}
+
+/* Find the row ranges of the cells that may reach im over roi.  The ROI is widened by the largest stencil reach of
+ * sigmaAccuracy sigmas and two pixels for the stencil rounding, or one pixel for histograms.  Each grid column
+ * gives one contiguous range, and ranges that touch are merged.
+ */
+template<class FloatT, class IdxT>
+void SRIndexedRender2D<FloatT,IdxT>::visible_runs(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy,
+                                                  std::vector<std::pair<std::size_t,std::size_t>> &runs) const
+{
+    if(roi.n_elem!=4) throw SRRenderError("BadROI","ROI must be [xmin, xmax, ymin, ymax]");
+    runs.clear();
+    if(points.n_rows==0) return;
+    if(im.n_elem==0) { //Nothing to render into; let SRRender2D handle the empty image
+        runs.emplace_back(0, points.n_rows);
+        return;
+    }
+    double pixelX = (roi(1)-roi(0))/im.n_cols;
+    double pixelY = (roi(3)-roi(2))/im.n_rows;
+    double haloX = sigmaAccuracy>0 ? sigmaAccuracy*max_sigma_x + 2*pixelX : pixelX;
+    double haloY = sigmaAccuracy>0 ? sigmaAccuracy*max_sigma_y + 2*pixelY : pixelY;
+    double x0 = (roi(0)-haloX-xmin)/cell_size, x1 = (roi(1)+haloX-xmin)/cell_size;
+    double y0 = (roi(2)-haloY-ymin)/cell_size, y1 = (roi(3)+haloY-ymin)/cell_size;
+    if(!(x1>=0 && y1>=0 && x0<cells_x && y0<cells_y)) return;
+    IdxT cx0 = static_cast<IdxT>(std::max(0., x0)), cx1 = static_cast<IdxT>(std::min<double>(cells_x-1, x1));
+    IdxT cy0 = static_cast<IdxT>(std::max(0., y0)), cy1 = static_cast<IdxT>(std::min<double>(cells_y-1, y1));
+    for(IdxT cx=cx0; cx<=cx1; cx++) {
+        std::size_t begin = cell_offsets[static_cast<std::size_t>(cx)*cells_y+cy0];
+        std::size_t end = cell_offsets[static_cast<std::size_t>(cx)*cells_y+cy1+1];
+        if(begin==end) continue;
+        if(!runs.empty() && runs.back().second==begin) runs.back().second = end;
+        else runs.emplace_back(begin, end);
+    }
+}
+
+/* Copy the points that may reach im over roi into visible.  If that is every point, visible is left empty with
+ * n_rows equal to the number of points, so callers render from the index directly without a copy.
+ */
+template<class FloatT, class IdxT>
+void SRIndexedRender2D<FloatT,IdxT>::gather(const VecT &roi, const ImageT &im, FloatT sigmaAccuracy,
+                                            EmitterVecT &visible) const
+{
+    std::vector<std::pair<std::size_t,std::size_t>> runs;
+    visible_runs(roi, im, sigmaAccuracy, runs);
+    if(runs.size()==1 && runs[0].first==0 && runs[0].second==points.n_rows) {
+        visible.set_size(points.n_rows, 0);
+        return;
+    }
+    std::size_t count = 0;
+    for(auto &run: runs) count += run.second-run.first;
+    visible.set_size(count, points.n_cols);
+    for(arma::uword c=0; c<points.n_cols; c++) {
+        FloatT *out = visible.colptr(c);
+        for(auto &run: runs) out = std::copy(points.colptr(c)+run.first, points.colptr(c)+run.second, out);
+    }
+}
+
+/* Explicit Template Instantiation */
+template class SRIndexedRender2D<float>;
+template class SRIndexedRender2D<double>;
+template SRIndexedRender2D<float>::SRIndexedRender2D(const PointView<float>&, float);
+template SRIndexedRender2D<float>::SRIndexedRender2D(const PointView<double>&, float);
+template SRIndexedRender2D<double>::SRIndexedRender2D(const PointView<float>&, double);
+template SRIndexedRender2D<double>::SRIndexedRender2D(const PointView<double>&, double);
+
+} /* namespace srrender */
@@ -6,32 +6,475 @@
  * Rendering of SR emitter localizations
  */
 #include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
 #include "SRRender/SRRender.h"
+#include "SRRender/BinEmitters.h"
+#include "SRRender/Kernels.h"
+#include "SRRender/RenderStats.h"
 
 namespace srrender {
 
+namespace {
+
+using binning::bin_emitters;
+
+/* Bin N emitters into the tiles of a tilesX x tilesY grid of square tiles of tileSize pixels.
+ * Each emitter is placed in every tile its pixel footprint overlaps, i.e., each tile is padded by the stencil halo.
+ * footprint(n, xmin, xmax, ymin, ymax) gives the clipped pixel footprint of emitter n and returns false if the
+ * emitter misses the image.  Tile t=tx*tilesY+ty holds tileEmitters[tileOffsets[t] ... tileOffsets[t+1]-1].
+ */
+template<class IdxT, class FootprintFuncT>
+void bin_emitters_by_tile(IdxT N, IdxT tileSize, IdxT tilesX, IdxT tilesY, FootprintFuncT footprint,
+                          std::vector<std::size_t> &tileOffsets, std::vector<IdxT> &tileEmitters)
+{
+    auto tilesOf = [&](IdxT n, auto add) {
+        IdxT xmin, xmax, ymin, ymax;
+        if(!footprint(n, xmin, xmax, ymin, ymax)) return;
+        for(IdxT tx=xmin/tileSize; tx<=xmax/tileSize; tx++) for(IdxT ty=ymin/tileSize; ty<=ymax/tileSize; ty++)
+            add(static_cast<std::size_t>(tx)*tilesY+ty);
+    };
+    bin_emitters(N, static_cast<std::size_t>(tilesX)*tilesY, tilesOf, tileOffsets, tileEmitters);
+}
+
+/* Count the emitters in each frame.  Throws if any frame index is not in [0,nFrames). */
+template<class IdxT, class PointsT>
+void count_emitters_by_frame(const PointsT &points, IdxT nFrames, std::vector<std::size_t> &frameCounts)
+{
+    IdxT N = static_cast<IdxT>(points.n_points());
+    frameCounts.assign(nFrames, 0);
+    for(IdxT n=0; n<N; n++) {
+        if(!(points.frame(n)>=0 && points.frame(n)<nFrames))
+            throw SRRenderError("BadFrameIndex", "Frame index "+std::to_string(points.frame(n))+
+                                " not in movie with "+std::to_string(nFrames)+" frames.");
+        frameCounts[static_cast<IdxT>(points.frame(n))]++;
+    }
+}
+
+/* Zero im.  With RenderOptions::firstTouch the columns are zeroed in parallel with a static schedule, so the pages of
+ * a new image are placed on the memory nodes of the threads that go on to write them.
+ */
+template<class FloatT>
+void zero_image(arma::Mat<FloatT> &im)
+{
+    if(!RenderOptionsScope::active().firstTouch) {
+        im.zeros();
+        return;
+    }
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(arma::uword x=0; x<im.n_cols; x++) std::fill_n(im.colptr(x), im.n_rows, FloatT(0));
+    });
+}
+
+/* A unit of movie rendering work: the emitters of frame whose footprints overlap the image columns [xBegin,xEnd).
+ * They are stripeEmitters[begin ... end-1] of the stripe binning. */
+template<class IdxT>
+struct FrameStripe {
+    IdxT frame;
+    IdxT xBegin;
+    IdxT xEnd;
+    std::size_t begin;
+    std::size_t end;
+};
+
+/* Split the frames of a movie into column stripes that each hold no more than about 1/4 of a thread's share of the
+ * emitters, so dense frames are rendered by several threads each owning different columns, and bin the N emitters
+ * into the stripes their footprints overlap, so each stripe visits only its own emitters.  Stripes are ordered by
+ * decreasing number of emitters so dynamic scheduling balances the load (longest processing time first).
+ * frameOf(n) gives the frame of emitter n, and columns(n, xmin, xmax) its clipped footprint columns, returning false
+ * if it misses the image.
+ */
+template<class IdxT, class FrameFuncT, class ColumnsFuncT>
+std::vector<FrameStripe<IdxT>> bin_frame_stripes(IdxT N, const std::vector<std::size_t> &frameCounts, IdxT pixelsX,
+                                                 FrameFuncT frameOf, ColumnsFuncT columns,
+                                                 std::vector<IdxT> &stripeEmitters)
+{
+    std::size_t nFrames = frameCounts.size();
+    std::size_t num_threads = RenderOptionsScope::threads();
+    std::size_t target = std::max<std::size_t>(1, N/(4*num_threads));
+    std::size_t maxParts = std::max<std::size_t>(1, std::min<std::size_t>(num_threads, pixelsX));
+    std::vector<FrameStripe<IdxT>> stripes;
+    std::vector<std::size_t> firstStripe(nFrames+1);
+    for(std::size_t f=0; f<nFrames; f++) {
+        firstStripe[f] = stripes.size();
+        std::size_t parts = std::min(maxParts, (frameCounts[f]+target-1)/target);
+        for(std::size_t j=0; j<parts; j++)
+            stripes.push_back({static_cast<IdxT>(f), static_cast<IdxT>(j*pixelsX/parts),
+                               static_cast<IdxT>((j+1)*pixelsX/parts), 0, 0});
+    }
+    firstStripe[nFrames] = stripes.size();
+    auto stripesOf = [&](IdxT n, auto add) {
+        IdxT xmin, xmax;
+        if(!columns(n, xmin, xmax)) return;
+        std::size_t f = frameOf(n);
+        for(std::size_t s=firstStripe[f]; s<firstStripe[f+1]; s++)
+            if(stripes[s].xBegin<=xmax && xmin<stripes[s].xEnd) add(s);
+    };
+    std::vector<std::size_t> stripeOffsets;
+    bin_emitters(N, stripes.size(), stripesOf, stripeOffsets, stripeEmitters);
+    for(std::size_t s=0; s<stripes.size(); s++) {
+        stripes[s].begin = stripeOffsets[s];
+        stripes[s].end = stripeOffsets[s+1];
+    }
+    stripes.erase(std::remove_if(stripes.begin(), stripes.end(),
+                                 [](const FrameStripe<IdxT> &a) { return a.begin==a.end; }), stripes.end());
+    std::stable_sort(stripes.begin(), stripes.end(), [](const FrameStripe<IdxT> &a, const FrameStripe<IdxT> &b) {
+        return a.end-a.begin > b.end-b.begin;
+    });
+    return stripes;
+}
+
+#ifdef SRRENDER_STATS
+using StatsClock = std::chrono::steady_clock;
+
+/* Seconds since mark, moving mark to now */
+double lap_seconds(StatsClock::time_point &mark)
+{
+    auto now = StatsClock::now();
+    double secs = std::chrono::duration<double>(now-mark).count();
+    mark = now;
+    return secs;
+}
+
+/* Records one render engine call of nPoints points into the active RenderStatsScope, if any.
+ * lap(phase) adds the wall time since the previous lap to phase.  ThreadRecorders merge their counts in.
+ */
+class RenderRecorder {
+public:
+    explicit RenderRecorder(std::size_t nPoints) : stats(RenderStatsScope::active()), num_points(nPoints)
+    {
+        if(stats) start = mark = StatsClock::now();
+    }
+    ~RenderRecorder()
+    {
+        if(!stats) return;
+        stats->renders++;
+        stats->threads = std::max(stats->threads, local.threads);
+        stats->totalSeconds += std::chrono::duration<double>(StatsClock::now()-start).count();
+        stats->allocSeconds += local.allocSeconds;
+        stats->binSeconds += local.binSeconds;
+        stats->stencilSeconds += local.stencilSeconds;
+        stats->splatSeconds += local.splatSeconds;
+        stats->reduceSeconds += local.reduceSeconds;
+        stats->pointsRendered += num_points-local.pointsClipped;
+        stats->pointsClipped += local.pointsClipped;
+        stats->stencilPixels += local.stencilPixels;
+        stats->scratchBytes += local.scratchBytes;
+    }
+    bool active() const { return stats; }
+    void lap(double RenderStats::*phase) { if(stats) local.*phase += lap_seconds(mark); }
+    void restart() { if(stats) mark = StatsClock::now(); } //Skip recording the time since the last lap
+    void scratch(std::size_t bytes) { if(stats) local.scratchBytes += bytes; }
+    /* For engines that visit points more than once, count the points for which misses(n) is true in a separate pass */
+    template<class MissFuncT>
+    void count_clipped(std::size_t N, MissFuncT misses)
+    {
+        if(stats) for(std::size_t n=0; n<N; n++) if(misses(n)) local.pointsClipped++;
+    }
+private:
+    friend class ThreadRecorder;
+    RenderStats *stats;
+    std::size_t num_points;
+    RenderStats local;
+    StatsClock::time_point start, mark;
+};
+
+/* Per-thread counts and stencil/splat timings for a RenderRecorder, merged in on destruction */
+class ThreadRecorder {
+public:
+    explicit ThreadRecorder(RenderRecorder &rec_) : rec(rec_), active(rec_.active()) {}
+    ~ThreadRecorder()
+    {
+        if(!active) return;
+        #pragma omp critical(srrender_stats)
+        {
+            rec.local.threads = std::max(rec.local.threads, omp_get_num_threads());
+            rec.local.allocSeconds += local.allocSeconds;
+            rec.local.stencilSeconds += local.stencilSeconds;
+            rec.local.splatSeconds += local.splatSeconds;
+            rec.local.pointsClipped += local.pointsClipped;
+            rec.local.stencilPixels += local.stencilPixels;
+            rec.local.scratchBytes += local.scratchBytes;
+        }
+    }
+    void start() { if(active) mark = StatsClock::now(); }
+    void alloc_done() { if(active) local.allocSeconds += lap_seconds(mark); }
+    void stencil_done() { if(active) local.stencilSeconds += lap_seconds(mark); }
+    void splat_done(std::size_t pixels) { if(active) { local.splatSeconds += lap_seconds(mark); local.stencilPixels += pixels; } }
+    void added(std::size_t pixels) { if(active) local.stencilPixels += pixels; }
+    void clipped() { if(active) local.pointsClipped++; }
+    void scratch(std::size_t bytes) { if(active) local.scratchBytes += bytes; }
+private:
+    RenderRecorder &rec;
+    bool active;
+    RenderStats local;
+    StatsClock::time_point mark;
+};
+#else
+/* Instrumentation disabled: the recorders compile to nothing */
+class RenderRecorder {
+public:
+    explicit RenderRecorder(std::size_t) {}
+    bool active() const { return false; }
+    void lap(double RenderStats::*) {}
+    void restart() {}
+    void scratch(std::size_t) {}
+    template<class MissFuncT> void count_clipped(std::size_t, MissFuncT) {}
+};
+
+class ThreadRecorder {
+public:
+    explicit ThreadRecorder(RenderRecorder &) {}
+    void start() {}
+    void alloc_done() {}
+    void stencil_done() {}
+    void splat_done(std::size_t) {}
+    void added(std::size_t) {}
+    void clipped() {}
+    void scratch(std::size_t) {}
+};
+#endif
+
+} /* namespace */
+
 template<class FloatT, class IdxT>
 const FloatT SRRender2D<FloatT,IdxT>::DefaultSigmaAccuracy = 5.;
 
+template<class FloatT, class IdxT>
+const IdxT SRRender2D<FloatT,IdxT>::DefaultTileSize = 256;
+
+template<class FloatT, class IdxT>
+const IdxT SRRender2D<FloatT,IdxT>::FFTSubpixels = 4;
+
+template<class FloatT, class IdxT>
+const IdxT SRRender2D<FloatT,IdxT>::FFTMaxSigmaGroups = 16;
+
 template<class FloatT, class IdxT>
 const FloatT SRRender2D<FloatT,IdxT>::normexp = 1/sqrt(2);
 
+/* The EmitterVecT interface renders through a PointView of the standard points layout without copying */
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHist(const EmitterVecT &points, const VecT &roi, ImageT &im, Engine engine)
+{
+    renderHist(PointViewT(points),roi,im,engine);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                          Engine engine)
+{
+    renderGauss(PointViewT(points),roi,im,sigmaAccuracy,engine);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistMovie(const EmitterVecT &points, const VecT &roi, MovieT &im)
+{
+    renderHistMovie(PointViewT(points),roi,im);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovie(const EmitterVecT &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy)
+{
+    renderGaussMovie(PointViewT(points),roi,im,sigmaAccuracy);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistMovieWindowed(const EmitterVecT &points, const VecT &roi, MovieT &movie,
+                                                      IdxT window, IdxT stride)
+{
+    renderHistMovieWindowed(PointViewT(points),roi,movie,window,stride);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovieWindowed(const EmitterVecT &points, const VecT &roi, MovieT &movie,
+                                                       IdxT window, IdxT stride, FloatT sigmaAccuracy)
+{
+    renderGaussMovieWindowed(PointViewT(points),roi,movie,window,stride,sigmaAccuracy);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistMovieStream(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                    IdxT nFrames, const FrameSinkT &sink, IdxT framesInFlight)
+{
+    renderHistMovieStream(PointViewT(points),roi,pixelsX,pixelsY,nFrames,sink,framesInFlight);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovieStream(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                     IdxT nFrames, const FrameSinkT &sink, FloatT sigmaAccuracy,
+                                                     IdxT framesInFlight)
+{
+    renderGaussMovieStream(PointViewT(points),roi,pixelsX,pixelsY,nFrames,sink,sigmaAccuracy,framesInFlight);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistChannels(const EmitterVecT &points, const VecT &roi, MovieT &channels)
+{
+    renderHistChannels(PointViewT(points),roi,channels);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussChannels(const EmitterVecT &points, const VecT &roi, MovieT &channels,
+                                                  FloatT sigmaAccuracy)
+{
+    renderGaussChannels(PointViewT(points),roi,channels,sigmaAccuracy);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistChannels(const EmitterVecT &points, const VecT &roi, MovieT &im, const ImageT &weights)
+{
+    renderHistChannels(PointViewT(points),roi,im,weights);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussChannels(const EmitterVecT &points, const VecT &roi, MovieT &im, const ImageT &weights,
+                                                  FloatT sigmaAccuracy)
+{
+    renderGaussChannels(PointViewT(points),roi,im,weights,sigmaAccuracy);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistTiled(const EmitterVecT &points, const VecT &roi, ImageT &im, IdxT tileSize)
+{
+    renderHistTiled(PointViewT(points),roi,im,tileSize);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderHistSparse(const EmitterVecT &points, const VecT &roi, ImageT &im)
+{
+    renderHistSparse(PointViewT(points),roi,im);
+}
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderHist(const EmitterVecT &points, const VecT &roi, ImageT &im)
+void SRRender2D<FloatT,IdxT>::renderHistSparse(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY, SpImageT &im)
 {
-//     #ifdef DEBUG
-//     checkPoints(points);
-//     #endif
-    if (points.n_rows >= sqrt(im.n_elem)) {
-        renderHistParallel(points,roi,im);
-    } else {
-        renderHistSingle(points,roi,im);
+    renderHistSparse(PointViewT(points),roi,pixelsX,pixelsY,im);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussTiled(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy, IdxT tileSize)
+{
+    renderGaussTiled(PointViewT(points),roi,im,sigmaAccuracy,tileSize);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, const StencilTableT &table,
+                                          Engine engine)
+{
+    renderGauss(PointViewT(points),roi,im,table,engine);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, const ErrorBudget &budget,
+                                          Engine engine)
+{
+    renderGauss(PointViewT(points),roi,im,budget,engine);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovie(const EmitterVecT &points, const VecT &roi, MovieT &im, const StencilTableT &table)
+{
+    renderGaussMovie(PointViewT(points),roi,im,table);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussTiled(const EmitterVecT &points, const VecT &roi, ImageT &im, const StencilTableT &table, IdxT tileSize)
+{
+    renderGaussTiled(PointViewT(points),roi,im,table,tileSize);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussPyramid(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                 IdxT nLevels, PyramidT &pyramid, FloatT sigmaAccuracy)
+{
+    renderGaussPyramid(PointViewT(points),roi,pixelsX,pixelsY,nLevels,pyramid,sigmaAccuracy);
+}
+
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::renderGaussPyramid(const EmitterVecT &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                 IdxT nLevels, PyramidT &pyramid, const StencilTableT &table)
+{
+    renderGaussPyramid(PointViewT(points),roi,pixelsX,pixelsY,nLevels,pyramid,table);
+}
+
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHist(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, Engine engine)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y});
+    if(engine==Engine::FFT) throw SRRenderError("BadEngine","Engine::FFT is only available for renderGauss");
+    if(engine==Engine::Auto) engine = select_engine(points,im,roi,0,nullptr,false);
+    switch(engine) {
+        case Engine::Parallel:
+            renderHistParallel(points,roi,im);
+            break;
+        case Engine::Tiled:
+            renderHistTiled(points,roi,im,DefaultTileSize,false);
+            break;
+        default:
+            im.zeros();
+            renderHistSingle(points,roi,im);
+    }
+}
+
+/* Resolve Engine::Auto to the exact engine with the lowest cost in the global CostModel.  Mean Gaussian stencil
+ * sizes are estimated from an evenly spaced sample of the points.  The approximate FFT engine is never chosen.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+typename SRRender2D<FloatT,IdxT>::Engine
+SRRender2D<FloatT,IdxT>::select_engine(const PointView<PointFloatT> &points, const ImageT &im, const VecT &roi,
+                                       FloatT sigmaAccuracy, const StencilTableT *table, bool gauss,
+                                       const FloatT *accuracies)
+{
+    CostModel::Problem problem;
+    problem.nPoints = points.n_points();
+    problem.pixelsX = im.n_cols;
+    problem.pixelsY = im.n_rows;
+    problem.bytesPerPixel = sizeof(FloatT);
+    problem.tileSize = DefaultTileSize;
+    problem.threads = RenderOptionsScope::threads();
+    if(gauss && problem.nPoints>0) {
+        const std::size_t maxSamples = 256;
+        std::size_t step = std::max<std::size_t>(1, problem.nPoints/maxSamples);
+        FloatT sizeRatioX = static_cast<FloatT>(im.n_cols) / (roi(1)-roi(0));
+        FloatT sizeRatioY = static_cast<FloatT>(im.n_rows) / (roi(3)-roi(2));
+        double sumX = 0, sumY = 0;
+        std::size_t nSamples = 0;
+        for(std::size_t n=0; n<problem.nPoints; n+=step, nSamples++) {
+            FloatT X = (points.X(n)-roi(0))*sizeRatioX;
+            FloatT Y = (points.Y(n)-roi(2))*sizeRatioY;
+            FloatT accuracyX = point_accuracy(accuracies, sigmaAccuracy, n, 0);
+            FloatT accuracyY = point_accuracy(accuracies, sigmaAccuracy, n, 1);
+            sumX += std::min<double>(2.*stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, accuracyX, table)+1, im.n_cols);
+            sumY += std::min<double>(2.*stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, accuracyY, table)+1, im.n_rows);
+        }
+        problem.stencilX = sumX/nSamples;
+        problem.stencilY = sumY/nSamples;
+        problem.computeStencils = !table;
     }
+    auto costs = CostModel::global().estimate(problem);
+    std::pair<double,Engine> best = std::min({std::make_pair(costs.single, Engine::Single),
+                                              std::make_pair(costs.parallel, Engine::Parallel),
+                                              std::make_pair(costs.tiled, Engine::Tiled)},
+                                             [](const std::pair<double,Engine> &a, const std::pair<double,Engine> &b) {
+                                                 return a.first < b.first; });
+    return best.second;
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderHistSingle(const EmitterVecT &points, const VecT &roi, ImageT &im)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistSingle(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im)
 {
     IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
@@ -39,15 +482,25 @@ void SRRender2D<FloatT,IdxT>::renderHistSingle(const EmitterVecT &points, const
     FloatT ymin = roi(2);
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
-    for(unsigned n=0; n<points.n_rows; n++){
-        IdxT ix = static_cast<IdxT>((points(n,1)-xmin)*sizeRatioX);
-        IdxT iy = static_cast<IdxT>((points(n,2)-ymin)*sizeRatioY);
-        if(0<=ix && ix<pixelsX && 0<=iy && iy<pixelsY) im(iy,ix) += points(n,0);
+    RenderRecorder rec(points.n_points());
+    ThreadRecorder trec(rec);
+    trec.start();
+    for(unsigned n=0; n<points.n_points(); n++){
+        IdxT ix, iy;
+        if(stencil_span(pixelsX, (points.X(n)-xmin)*sizeRatioX, 0, ix, ix) &&
+           stencil_span(pixelsY, (points.Y(n)-ymin)*sizeRatioY, 0, iy, iy)) {
+            im(iy,ix) += points.I(n);
+            trec.added(1);
+        } else {
+            trec.clipped();
+        }
     }
+    trec.splat_done(0);
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderHistParallel(const EmitterVecT &points, const VecT &roi, ImageT &im)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistParallel(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im)
 {
     IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
@@ -56,34 +509,50 @@ void SRRender2D<FloatT,IdxT>::renderHistParallel(const EmitterVecT &points, cons
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
 
-    IdxT max_threads = omp_get_max_threads();
+    RenderRecorder rec(points.n_points());
+    IdxT max_threads = RenderOptionsScope::threads();
     arma::field<ImageT> histF(max_threads);
     IdxT num_threads;
-    #pragma omp parallel
-    {
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
         ImageT hist(im.n_rows,im.n_cols);
         hist.zeros();
+        trec.alloc_done();
+        trec.scratch(hist.n_elem*sizeof(FloatT));
         num_threads=omp_get_num_threads(); //Save number of threads actually run
-        #pragma omp for
-        for(unsigned n=0; n<points.n_rows; n++){
-            IdxT ix = static_cast<IdxT>((points(n,1)-xmin)*sizeRatioX);
-            IdxT iy = static_cast<IdxT>((points(n,2)-ymin)*sizeRatioY);
-            if(0<=ix && ix<pixelsX && 0<=iy && iy<pixelsY) hist(iy,ix) += points(n,0); //intensity
+        #pragma omp for nowait
+        for(unsigned n=0; n<points.n_points(); n++){
+            IdxT ix, iy;
+            if(stencil_span(pixelsX, (points.X(n)-xmin)*sizeRatioX, 0, ix, ix) &&
+               stencil_span(pixelsY, (points.Y(n)-ymin)*sizeRatioY, 0, iy, iy)) {
+                hist(iy,ix) += points.I(n); //intensity
+                trec.added(1);
+            } else {
+                trec.clipped();
+            }
         }
-        histF(omp_get_thread_num()) = hist;
-    }
-    //Parellelize sum of individual historgrams over columns
-    #pragma omp parallel for
-    for(IdxT x=0; x<pixelsX; x++) for(IdxT y=0; y<pixelsY; y++) {
-        FloatT sum = 0.0;
-        for(IdxT n=0;n<num_threads; n++) sum += histF(n)(y,x);
-        im(y,x) = sum;
-    }
+        trec.splat_done(0);
+        histF(omp_get_thread_num()) = std::move(hist);
+    });
+    rec.restart();
+    //Parellelize sum of individual historgrams over columns.  The static schedule matches placement by firstTouch.
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(IdxT x=0; x<pixelsX; x++) for(IdxT y=0; y<pixelsY; y++) {
+            FloatT sum = 0.0;
+            for(IdxT n=0;n<num_threads; n++) sum += histF(n)(y,x);
+            im(y,x) = sum;
+        }
+    });
+    rec.lap(&RenderStats::reduceSeconds);
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderHistMovie(const EmitterVecT &points, const VecT &roi, MovieT &im)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im)
 {
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::Frame});
     IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
     FloatT xmin = roi(0);
@@ -91,35 +560,156 @@ void SRRender2D<FloatT,IdxT>::renderHistMovie(const EmitterVecT &points, const V
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
 
-    #pragma omp parallel
-    {
-        IdxT num_threads = omp_get_num_threads(); //Number we actually created my be less than max
-        IdxT tid = omp_get_thread_num();
-        for(unsigned n=0; n<points.n_rows; n++){
-            IdxT frame = points(n,5);
-            if (frame%num_threads != tid) continue;
-            IdxT ix = static_cast<IdxT>((points(n,1)-xmin)*sizeRatioX);
-            IdxT iy = static_cast<IdxT>((points(n,2)-ymin)*sizeRatioY);
-            if(0<=ix && ix<pixelsX && 0<=iy && iy<pixelsY) im(iy,ix,frame) += points(n,0);
+    IdxT N = static_cast<IdxT>(points.n_points());
+    RenderRecorder rec(N);
+    auto pixelOf = [&](IdxT n, IdxT &ix, IdxT &iy) {
+        return stencil_span(pixelsX, (points.X(n)-xmin)*sizeRatioX, 0, ix, ix) &&
+               stencil_span(pixelsY, (points.Y(n)-ymin)*sizeRatioY, 0, iy, iy);
+    };
+    std::vector<std::size_t> frameCounts;
+    std::vector<IdxT> stripeEmitters;
+    count_emitters_by_frame(points, static_cast<IdxT>(im.n_slices), frameCounts);
+    auto stripes = bin_frame_stripes(N, frameCounts, pixelsX, [&](IdxT n) { return static_cast<IdxT>(points.frame(n)); },
+                                     [&](IdxT n, IdxT &ixmin, IdxT &ixmax) {
+                                         IdxT iy;
+                                         if(!pixelOf(n, ixmin, iy)) return false;
+                                         ixmax = ixmin;
+                                         return true;
+                                     }, stripeEmitters);
+    rec.scratch(frameCounts.size()*sizeof(std::size_t) + stripeEmitters.size()*sizeof(IdxT) +
+                stripes.size()*sizeof(stripes[0]));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](IdxT n) { IdxT ix, iy; return !pixelOf(n, ix, iy); });
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
+        #pragma omp for schedule(dynamic) nowait
+        for(std::size_t s=0; s<stripes.size(); s++) {
+            IdxT frame = stripes[s].frame;
+            std::size_t added = 0;
+            for(std::size_t k=stripes[s].begin; k<stripes[s].end; k++) {
+                IdxT n = stripeEmitters[k];
+                IdxT ix=0, iy=0;
+                if(!pixelOf(n, ix, iy)) continue;
+                im(iy,ix,frame) += points.I(n);
+                added++;
+            }
+            trec.added(added);
         }
+        trec.splat_done(0);
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                          Engine engine)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGauss(points,roi,im,sigmaAccuracy,nullptr,engine);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, const StencilTableT &table,
+                                          Engine engine)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGauss(points,roi,im,table.get_sigma_accuracy(),&table,engine);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, const ErrorBudget &budget,
+                                          Engine engine)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    if(!(budget.tolerance>0) || !std::isfinite(budget.tolerance))
+        throw SRRenderError("BadErrorBudget","ErrorBudget tolerance must be positive and finite");
+    if(engine==Engine::FFT) throw SRRenderError("BadEngine","Engine::FFT does not truncate stencils to an ErrorBudget");
+    std::vector<FloatT> accuracies;
+    adaptive_accuracies(points,roi,im,budget,accuracies);
+    renderGauss(points,roi,im,DefaultSigmaAccuracy,nullptr,engine,accuracies.data());
+}
+
+/* Dispatch a Gaussian render to engine.  If accuracies is given it holds the per-point (X,Y) sigmaAccuracy pairs
+ * that replace sigmaAccuracy, and FFT is never selected.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGauss(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                          const StencilTableT *table, Engine engine, const FloatT *accuracies)
+{
+    if(engine==Engine::Auto) engine = select_engine(points,im,roi,sigmaAccuracy,table,true,accuracies);
+    switch(engine) {
+        case Engine::Parallel:
+            renderGaussParallel(points,roi,im,sigmaAccuracy,table,accuracies);
+            break;
+        case Engine::Tiled:
+            renderGaussTiled(points,roi,im,sigmaAccuracy,table,DefaultTileSize,false,accuracies);
+            break;
+        case Engine::FFT:
+            renderGaussFFT(points,roi,im,sigmaAccuracy);
+            break;
+        default:
+            im.zeros();
+            renderGaussSingle(points,roi,im,sigmaAccuracy,table,accuracies);
     }
 }
 
+/* Choose the sigmaAccuracy along each axis of each point for renders with an ErrorBudget.
+ *
+ * A stencil of halfwidth h covers the pixels [floor(X)-h, floor(X)+h], so every pixel it drops along an axis is at
+ * least d = h+min(frac(X),1-frac(X)) from the emitter, and holds at most the Gaussian tail mass beyond d,
+ * erfc(d/(sigma*sqrt(2)))/2 <= exp(-d^2/(2*sigma^2))/2, of the emitter along that axis.  Along the other axis no
+ * pixel holds more than min(1, 1/(sigma*sqrt(2*pi))) of the emitter.  The smallest h with I times both factors
+ * under the tolerance is returned as the sigmaAccuracy h/sigma, so make_stencil() uses exactly that halfwidth.
+ * [out] accuracies - N (X,Y) pairs
+ */
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderGauss(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::adaptive_accuracies(const PointView<PointFloatT> &points, const VecT &roi, const ImageT &im,
+                                                  const ErrorBudget &budget, std::vector<FloatT> &accuracies)
 {
-//     #ifdef DEBUG
-//     checkPoints(points);
-//     #endif
-    if (points.n_rows >= sqrt(im.n_elem)) {
-        renderGaussParallel(points,roi,im,sigmaAccuracy);
-    } else {
-        renderGaussSingle(points,roi,im,sigmaAccuracy);
+    std::size_t N = points.n_points();
+    accuracies.resize(2*N);
+    if(N==0 || im.n_elem==0) return;
+    double sizeRatioX = im.n_cols / static_cast<double>(roi(1)-roi(0));
+    double sizeRatioY = im.n_rows / static_cast<double>(roi(3)-roi(2));
+    const double invSqrt2Pi = 0.3989422804014327;
+    auto peak = [&](double sigma) { return sigma>0 ? std::min(1., invSqrt2Pi/sigma) : 1.; };
+    double tolerance = budget.tolerance;
+    if(budget.kind==ErrorBudget::Kind::Relative) {
+        double maxPeak = 0;
+        for(std::size_t n=0; n<N; n++)
+            maxPeak = std::max(maxPeak, std::abs(static_cast<double>(points.I(n)))*peak(points.sigmaX(n)*sizeRatioX)*
+                                                                                  peak(points.sigmaY(n)*sizeRatioY));
+        tolerance *= maxPeak;
+        if(!(tolerance>0)) tolerance = std::numeric_limits<double>::min(); //All points have zero intensity
     }
+    //Accuracy along an axis for an emitter at pixel coordinate X of width sigma, with scale = I * other-axis peak
+    auto accuracy = [&](double scale, double X, double sigma) {
+        if(!(sigma>0) || !(scale>2*tolerance)) return 0.;
+        double frac = X-std::floor(X);
+        double d = sigma*std::sqrt(2*std::log(scale/(2*tolerance)));
+        return std::max(0., std::ceil(d-std::min(frac, 1-frac)))/sigma;
+    };
+    parallel_region([&]{
+        #pragma omp for
+        for(std::size_t n=0; n<N; n++) {
+            double I = std::abs(static_cast<double>(points.I(n)));
+            double sigmaX = points.sigmaX(n)*sizeRatioX, sigmaY = points.sigmaY(n)*sizeRatioY;
+            double X = (points.X(n)-roi(0))*sizeRatioX, Y = (points.Y(n)-roi(2))*sizeRatioY;
+            accuracies[2*n] = static_cast<FloatT>(accuracy(I*peak(sigmaY), X, sigmaX));
+            accuracies[2*n+1] = static_cast<FloatT>(accuracy(I*peak(sigmaX), Y, sigmaY));
+        }
+    });
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderGaussSingle(const EmitterVecT &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussSingle(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                                const StencilTableT *table, const FloatT *accuracies)
 {
     IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
@@ -127,39 +717,31 @@ void SRRender2D<FloatT,IdxT>::renderGaussSingle(const EmitterVecT &points, const
     FloatT imageYmin = roi(2);
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
-    IdxT N = static_cast<IdxT>(points.n_rows);
+    IdxT N = static_cast<IdxT>(points.n_points());
+    RenderRecorder rec(N);
     VecT xStencil(pixelsX), yStencil(pixelsY);
-    im.zeros();
+    rec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+    rec.lap(&RenderStats::allocSeconds);
+    if(im.n_elem==0) return;
+    ThreadRecorder trec(rec);
     for(IdxT n=0; n<N; n++) {
-        FloatT X = (points(n,1)-imageXmin)*sizeRatioX;
-        FloatT sigmaX = points(n,3)*sizeRatioX;
-        IdxT xp = static_cast<IdxT>(X); // 0 <= xp < pixelsX
-        IdxT xhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaX); //halfwidth for gaussian X
-        IdxT xmin = xp <= xhw ? 0 : xp-xhw;
-        IdxT xmax = std::min(pixelsX-1,xp+xhw);
-        IdxT xspn = xmax-xmin+1;
-
-        FloatT Y = (points(n,2)-imageYmin)*sizeRatioY;
-        FloatT sigmaY = points(n,4)*sizeRatioY;
-        IdxT yp = static_cast<IdxT>(Y); // 0 <= yp < pixelsY
-        IdxT yhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaY); //halfwidth for gauissian Y
-        IdxT ymin = yp <= yhw ? 0 : yp-yhw;
-        IdxT ymax = std::min(pixelsY-1,yp+yhw);
-        IdxT yspn = ymax-ymin+1;
-
-        if(xspn<=0 || yspn<=0) continue;
-        fill_stencil(xspn, X-xmin, sigmaX, xStencil);
-        fill_stencil(yspn, Y-ymin, sigmaY, yStencil);
-        FloatT I = points(n,0);
-        for(IdxT x=0; x<xspn; x++) xStencil(x)*=I; //Pre-multiply by I;
-        //Copy in image of new gaussian
-        for(IdxT x=xmin; x<=xmax; x++) for(IdxT y=ymin; y<=ymax; y++)
-            im(y,x) += xStencil(x-xmin) * yStencil(y-ymin);
+        IdxT xmin, xmax, ymin, ymax;
+        trec.start();
+        const FloatT *xs = make_stencil(0, pixelsX-1, (points.X(n)-imageXmin)*sizeRatioX, points.sigmaX(n)*sizeRatioX,
+                                        point_accuracy(accuracies, sigmaAccuracy, n, 0), table, xmin, xmax, xStencil);
+        const FloatT *ys = xs ? make_stencil(0, pixelsY-1, (points.Y(n)-imageYmin)*sizeRatioY, points.sigmaY(n)*sizeRatioY,
+                                             point_accuracy(accuracies, sigmaAccuracy, n, 1), table, ymin, ymax, yStencil) : nullptr;
+        if(!ys) { trec.clipped(); continue; }
+        trec.stencil_done();
+        splat(im.memptr(), pixelsY, points.I(n), xmin, xmax, xs, ymin, ymax, ys);
+        trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1));
     }
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderGaussParallel(const EmitterVecT &points, const VecT &roi, ImageT &final_image, FloatT sigmaAccuracy)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussParallel(const PointView<PointFloatT> &points, const VecT &roi, ImageT &final_image, FloatT sigmaAccuracy,
+                                                  const StencilTableT *table, const FloatT *accuracies)
 {
     IdxT pixelsX =  static_cast<IdxT>(final_image.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(final_image.n_rows); //number of output pixels in the Y direction (down columns)
@@ -167,56 +749,260 @@ void SRRender2D<FloatT,IdxT>::renderGaussParallel(const EmitterVecT &points, con
     FloatT imageYmin = roi(2);
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
-    IdxT N = static_cast<IdxT>(points.n_rows);
-    IdxT max_threads = omp_get_max_threads();
+    IdxT N = static_cast<IdxT>(points.n_points());
+    RenderRecorder rec(N);
+    IdxT max_threads = RenderOptionsScope::threads();
     IdxT num_threads;
     arma::field<ImageT> imStack(max_threads);
-    #pragma omp parallel
-    {
+    if(final_image.n_elem==0) return;
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
         ImageT im(pixelsY,pixelsX,arma::fill::zeros);
-        num_threads = omp_get_num_threads(); //Number we actually created my be less than max
         VecT xStencil(pixelsX), yStencil(pixelsY);
+        trec.alloc_done();
+        trec.scratch((im.n_elem+xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
         num_threads = omp_get_num_threads(); //Number we actually created my be less than max
         #pragma omp for
         for(IdxT n=0; n<N; n++) {
-            FloatT X = (points(n,1)-imageXmin)*sizeRatioX;
-            FloatT sigmaX = points(n,3)*sizeRatioX;
-            IdxT xp = static_cast<IdxT>(X); // 0 <= xp < pixelsX
-            IdxT xhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaX); //halfwidth for gaussian X
-            IdxT xmin = xp <= xhw ? 0 : xp-xhw;
-            IdxT xmax = std::min(pixelsX-1,xp+xhw);
-            IdxT xspn = xmax-xmin+1;
-
-            FloatT Y = (points(n,2)-imageYmin)*sizeRatioY;
-            FloatT sigmaY = points(n,4)*sizeRatioY;
-            IdxT yp = static_cast<IdxT>(Y); // 0 <= yp < pixelsY
-            IdxT yhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaY); //halfwidth for gauissian Y
-            IdxT ymin = yp <= yhw ? 0 : yp-yhw;
-            IdxT ymax = std::min(pixelsY-1,yp+yhw);
-            IdxT yspn = ymax-ymin+1;
-
-            if(xspn<=0 || yspn<=0) continue;
-            fill_stencil(xspn, X-xmin, sigmaX, xStencil);
-            fill_stencil(yspn, Y-ymin, sigmaY, yStencil);
-            FloatT I = points(n,0);
-            for(IdxT x=0; x<xspn; x++) xStencil(x)*=I; //Pre-multiply by I;
-            //Copy in image of new gaussian
-            for(IdxT x=xmin; x<=xmax; x++) for(IdxT y=ymin; y<=ymax; y++)
-                im(y,x) += xStencil(x-xmin) * yStencil(y-ymin);
+            IdxT xmin, xmax, ymin, ymax;
+            trec.start();
+            const FloatT *xs = make_stencil(0, pixelsX-1, (points.X(n)-imageXmin)*sizeRatioX, points.sigmaX(n)*sizeRatioX,
+                                            point_accuracy(accuracies, sigmaAccuracy, n, 0), table, xmin, xmax, xStencil);
+            const FloatT *ys = xs ? make_stencil(0, pixelsY-1, (points.Y(n)-imageYmin)*sizeRatioY, points.sigmaY(n)*sizeRatioY,
+                                                 point_accuracy(accuracies, sigmaAccuracy, n, 1), table, ymin, ymax, yStencil) : nullptr;
+            if(!ys) { trec.clipped(); continue; }
+            trec.stencil_done();
+            splat(im.memptr(), pixelsY, points.I(n), xmin, xmax, xs, ymin, ymax, ys);
+            trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1));
         }
-        imStack(omp_get_thread_num()) = im;
+        imStack(omp_get_thread_num()) = std::move(im);
+    });
+    rec.restart();
+    //Parellelize sum of individual historgrams over columns.  The static schedule matches placement by firstTouch.
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(IdxT x=0; x<pixelsX; x++) for(IdxT y=0; y<pixelsY; y++) {
+            FloatT sum = 0.0;
+            for(IdxT n=0;n<num_threads; n++) sum += imStack(n)(y,x);
+            final_image(y,x) = sum;
+        }
+    });
+    rec.lap(&RenderStats::reduceSeconds);
+}
+
+/* Find the distinct (sigmaX,sigmaY) pairs of the points.  Returns false if there are more than FFTMaxSigmaGroups.
+ * [out] groupOf - if given, the index in groups of the sigmas of each point
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+bool SRRender2D<FloatT,IdxT>::sigma_groups(const PointView<PointFloatT> &points,
+                                           std::vector<std::pair<PointFloatT,PointFloatT>> &groups, std::vector<IdxT> *groupOf)
+{
+    groups.clear();
+    if(groupOf) groupOf->resize(points.n_points());
+    IdxT g = 0;
+    for(std::size_t n=0; n<points.n_points(); n++) {
+        std::pair<PointFloatT,PointFloatT> sigma(points.sigmaX(n), points.sigmaY(n));
+        if(groups.empty() || groups[g]!=sigma) {
+            g = static_cast<IdxT>(std::find(groups.begin(), groups.end(), sigma) - groups.begin());
+            if(g==groups.size()) {
+                if(groups.size()==FFTMaxSigmaGroups) return false;
+                groups.push_back(sigma);
+            }
+        }
+        if(groupOf) (*groupOf)[n] = g;
     }
-    //Parellelize sum of individual historgrams over columns
-    #pragma omp parallel for
-    for(IdxT x=0; x<pixelsX; x++) for(IdxT y=0; y<pixelsY; y++) {
-        FloatT sum = 0.0;
-        for(IdxT n=0;n<num_threads; n++) sum += imStack(n)(y,x);
-        final_image(y,x) = sum;
+    return true;
+}
+
+/* Render by FFT convolution, once for each distinct sigma.
+ * Each emitter is deposited linearly between the centers of the four nearest bins of a histogram with FFTSubpixels
+ * bins per pixel, padded by the stencil halfwidth plus one pixel so emitters just off the image are included.
+ * The histogram is convolved along Y with the pixel-integrated Gaussian in bands of columns and sampled at the
+ * output pixel rows, then the result is convolved along X in bands of rows and sampled at the output pixel columns.
+ * The linear deposit gives errors of second order in the bin width.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussFFT(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im,
+                                             FloatT sigmaAccuracy)
+{
+    const IdxT s = FFTSubpixels;
+    const IdxT bandWidth = 32; //Columns or rows transformed together
+    IdxT pixelsX = static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
+    IdxT pixelsY = static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
+    FloatT xmin = roi(0);
+    FloatT ymin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT N = static_cast<IdxT>(points.n_points());
+
+    RenderRecorder rec(N);
+    std::vector<std::pair<PointFloatT,PointFloatT>> groups;
+    std::vector<IdxT> groupOf;
+    if(!sigma_groups(points, groups, &groupOf))
+        throw SRRenderError("BadEngine","Engine::FFT renders at most "+std::to_string(FFTMaxSigmaGroups)+" distinct sigmas");
+    std::vector<std::size_t> groupOffsets;
+    std::vector<IdxT> groupEmitters;
+    bin_emitters(N, groups.size(), [&](IdxT n, auto add) { add(groupOf[n]); }, groupOffsets, groupEmitters);
+    im.zeros();
+    if(pixelsX==0 || pixelsY==0) return;
+    rec.lap(&RenderStats::binSeconds);
+
+    for(std::size_t g=0; g<groups.size(); g++) {
+        const IdxT *emitters = groupEmitters.data()+groupOffsets[g];
+        IdxT count = static_cast<IdxT>(groupOffsets[g+1]-groupOffsets[g]);
+        FloatT sigmaX = groups[g].first*sizeRatioX;
+        FloatT sigmaY = groups[g].second*sizeRatioY;
+        IdxT padX = (stencil_halfwidth(0, sigmaX, sigmaAccuracy, nullptr)+1)*s;
+        IdxT padY = (stencil_halfwidth(0, sigmaY, sigmaAccuracy, nullptr)+1)*s;
+        IdxT fineX = pixelsX*s + 2*padX;
+        IdxT fineY = pixelsY*s + 2*padY;
+        //Circular convolutions longer than the histogram plus the kernel reach do not wrap onto sampled bins
+        IdxT lengthX = fft_length(fineX+padX);
+        IdxT lengthY = fft_length(fineY+padY);
+        arma::Col<std::complex<FloatT>> kernelX = fft_kernel(sigmaX, padX, lengthX);
+        arma::Col<std::complex<FloatT>> kernelY = fft_kernel(sigmaY, padY, lengthY);
+        auto deposit = [&](IdxT k, IdxT &jx, FloatT &wx, IdxT &jy, FloatT &wy) {
+            IdxT n = emitters[k];
+            FloatT tx = (points.X(n)-xmin)*sizeRatioX*s + padX - FloatT(0.5); //position in bin centers
+            FloatT ty = (points.Y(n)-ymin)*sizeRatioY*s + padY - FloatT(0.5);
+            if(!(tx>=0 && tx<fineX-1 && ty>=0 && ty<fineY-1)) return false;
+            jx = static_cast<IdxT>(tx);
+            jy = static_cast<IdxT>(ty);
+            wx = tx-jx;
+            wy = ty-jy;
+            return true;
+        };
+        IdxT nBandsX = (fineX+bandWidth-1)/bandWidth;
+        auto bandsOf = [&](IdxT k, auto add) {
+            IdxT jx, jy;
+            FloatT wx, wy;
+            if(!deposit(k, jx, wx, jy, wy)) return;
+            add(jx/bandWidth);
+            if((jx+1)/bandWidth != jx/bandWidth) add((jx+1)/bandWidth);
+        };
+        std::vector<std::size_t> bandOffsets;
+        std::vector<IdxT> bandEmitters;
+        bin_emitters(count, nBandsX, bandsOf, bandOffsets, bandEmitters);
+        rec.lap(&RenderStats::binSeconds);
+        rec.count_clipped(count, [&](IdxT k) { IdxT jx, jy; FloatT wx, wy; return !deposit(k, jx, wx, jy, wy); });
+        rec.restart();
+
+        ImageT blurred(fineX, pixelsY); //Histogram convolved along Y and sampled at pixel rows, transposed
+        parallel_region([&]{
+            ThreadRecorder trec(rec);
+            trec.start();
+            ImageT hist(lengthY, bandWidth);
+            trec.alloc_done();
+            trec.scratch(hist.n_elem*sizeof(FloatT));
+            #pragma omp for schedule(dynamic)
+            for(IdxT b=0; b<nBandsX; b++) {
+                IdxT x0 = b*bandWidth;
+                IdxT width = std::min(bandWidth, fineX-x0);
+                hist.zeros();
+                for(std::size_t e=bandOffsets[b]; e<bandOffsets[b+1]; e++) {
+                    IdxT k = bandEmitters[e];
+                    IdxT jx, jy;
+                    FloatT wx, wy;
+                    if(!deposit(k, jx, wx, jy, wy)) continue;
+                    FloatT I = points.I(emitters[k]); //intensity
+                    for(IdxT j=jx; j<=jx+1; j++) {
+                        if(j<x0 || j>=x0+width) continue;
+                        FloatT w = I*(j==jx ? 1-wx : wx);
+                        hist(jy, j-x0) += w*(1-wy);
+                        hist(jy+1, j-x0) += w*wy;
+                    }
+                }
+                arma::Mat<std::complex<FloatT>> F = arma::fft(hist);
+                for(IdxT c=0; c<width; c++) {
+                    std::complex<FloatT> *f = F.colptr(c);
+                    for(IdxT i=0; i<lengthY; i++) f[i] *= kernelY(i);
+                }
+                ImageT G = arma::real(arma::ifft(F));
+                for(IdxT c=0; c<width; c++) for(IdxT y=0; y<pixelsY; y++) blurred(x0+c, y) = G(y*s+padY, c);
+            }
+            trec.splat_done(0);
+        });
+        rec.scratch(blurred.n_elem*sizeof(FloatT));
+        IdxT nBandsY = (pixelsY+bandWidth-1)/bandWidth;
+        parallel_region([&]{
+            ThreadRecorder trec(rec);
+            trec.start();
+            ImageT rows(lengthX, bandWidth);
+            trec.alloc_done();
+            trec.scratch(rows.n_elem*sizeof(FloatT));
+            #pragma omp for schedule(dynamic)
+            for(IdxT b=0; b<nBandsY; b++) {
+                IdxT y0 = b*bandWidth;
+                IdxT height = std::min(bandWidth, pixelsY-y0);
+                rows.zeros();
+                for(IdxT c=0; c<height; c++) std::copy_n(blurred.colptr(y0+c), fineX, rows.colptr(c));
+                arma::Mat<std::complex<FloatT>> F = arma::fft(rows);
+                for(IdxT c=0; c<height; c++) {
+                    std::complex<FloatT> *f = F.colptr(c);
+                    for(IdxT i=0; i<lengthX; i++) f[i] *= kernelX(i);
+                }
+                ImageT G = arma::real(arma::ifft(F));
+                for(IdxT x=0; x<pixelsX; x++) for(IdxT c=0; c<height; c++) im(y0+c, x) += G(x*s+padX, c);
+            }
+            trec.splat_done(0);
+        });
+        rec.restart();
     }
 }
 
+/* FFT of the length len circular convolution kernel whose value at an offset of d sub-pixel bins, for |d|<=reach,
+ * is the integral over a pixel of a Gaussian of width sigma pixels centered d bins from the pixel's first bin center.
+ */
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::renderGaussMovie(const EmitterVecT &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy)
+arma::Col<std::complex<FloatT>> SRRender2D<FloatT,IdxT>::fft_kernel(FloatT sigma, IdxT reach, IdxT len)
+{
+    const FloatT s = static_cast<FloatT>(FFTSubpixels);
+    FloatT norm = normexp/sigma;
+    VecT kernel(len);
+    kernel.zeros();
+    for(IdxT i=0; i<=2*reach; i++) {
+        FloatT d = static_cast<FloatT>(i)-static_cast<FloatT>(reach)-FloatT(0.5);
+        kernel((i+len-reach)%len) = 0.5*(std::erf(norm*(d+s)/s) - std::erf(norm*d/s));
+    }
+    return arma::fft(kernel);
+}
+
+/* The smallest length of at least n with no prime factors above 5, for which FFTs are fast */
+template<class FloatT, class IdxT>
+IdxT SRRender2D<FloatT,IdxT>::fft_length(IdxT n)
+{
+    for(IdxT len=std::max<IdxT>(n,1); ; len++) {
+        IdxT m = len;
+        for(IdxT p: {IdxT(2), IdxT(3), IdxT(5)}) while(m%p==0) m /= p;
+        if(m==1) return len;
+    }
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    renderGaussMovie(points,roi,im,sigmaAccuracy,nullptr);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im, const StencilTableT &table)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    renderGaussMovie(points,roi,im,table.get_sigma_accuracy(),&table);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovie(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im, FloatT sigmaAccuracy,
+                                               const StencilTableT *table)
 {
     IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
     IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
@@ -224,83 +1010,1040 @@ void SRRender2D<FloatT,IdxT>::renderGaussMovie(const EmitterVecT &points, const
     FloatT imageYmin = roi(2);
     FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
     FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
-    IdxT N = static_cast<IdxT>(points.n_rows);
-    #pragma omp parallel
-    {
+    if(im.n_elem==0) return;
+
+    IdxT N = static_cast<IdxT>(points.n_points());
+    RenderRecorder rec(N);
+    //The columns of each footprint, found without computing the stencils
+    auto columns = [&](IdxT n, IdxT &xmin, IdxT &xmax) {
+        FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+        FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+        IdxT ymin, ymax;
+        return stencil_span(pixelsX, X, stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, sigmaAccuracy, table), xmin, xmax) &&
+               stencil_span(pixelsY, Y, stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, sigmaAccuracy, table), ymin, ymax);
+    };
+    std::vector<std::size_t> frameCounts;
+    std::vector<IdxT> stripeEmitters;
+    count_emitters_by_frame(points, static_cast<IdxT>(im.n_slices), frameCounts);
+    auto stripes = bin_frame_stripes(N, frameCounts, pixelsX, [&](IdxT n) { return static_cast<IdxT>(points.frame(n)); },
+                                     columns, stripeEmitters);
+    rec.scratch(frameCounts.size()*sizeof(std::size_t) + stripeEmitters.size()*sizeof(IdxT) +
+                stripes.size()*sizeof(stripes[0]));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](IdxT n) { IdxT xmin, xmax; return !columns(n, xmin, xmax); });
+    rec.restart();
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
         VecT xStencil(pixelsX), yStencil(pixelsY);
-        IdxT num_threads = omp_get_num_threads(); //Number we actually created my be less than max
-        IdxT tid = omp_get_thread_num();
-        for(IdxT n=0; n<N; n++) {
-            IdxT frame = points(n,5);
-            if (frame%num_threads != tid) continue;
-            FloatT X = (points(n,1)-imageXmin)*sizeRatioX;
-            FloatT sigmaX = points(n,3)*sizeRatioX;
-            IdxT xp = static_cast<IdxT>(X); // 0 <= xp < pixelsX
-            IdxT xhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaX); //halfwidth for gaussian X
-            IdxT xmin = xp <= xhw ? 0 : xp-xhw;
-            IdxT xmax = std::min(pixelsX-1,xp+xhw);
-            IdxT xspn = xmax-xmin+1;
-
-            FloatT Y = (points(n,2)-imageYmin)*sizeRatioY;
-            FloatT sigmaY = points(n,4)*sizeRatioY;
-            IdxT yp = static_cast<IdxT>(Y); // 0 <= yp < pixelsY
-            IdxT yhw = static_cast<IdxT>(0.5+sigmaAccuracy*sigmaY); //halfwidth for gauissian Y
-            IdxT ymin = yp <= yhw ? 0 : yp-yhw;
-            IdxT ymax = std::min(pixelsY-1,yp+yhw);
-            IdxT yspn = ymax-ymin+1;
-
-            if(xspn<=0 || yspn<=0) continue;
-            fill_stencil(xspn, X-xmin, sigmaX, xStencil);
-            fill_stencil(yspn, Y-ymin, sigmaY, yStencil);
-            FloatT I = points(n,0);
-            for(IdxT x=0; x<xspn; x++) xStencil(x)*=I; //Pre-multiply by I;
-            //Copy in image of new gaussian
-            for(IdxT x=xmin; x<=xmax; x++) for(IdxT y=ymin; y<=ymax; y++)
-                im(y,x,frame) += xStencil(x-xmin) * yStencil(y-ymin);
+        trec.alloc_done();
+        trec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+        #pragma omp for schedule(dynamic)
+        for(std::size_t s=0; s<stripes.size(); s++) {
+            IdxT frame = stripes[s].frame;
+            FloatT *frameIm = im.slice_memptr(frame);
+            for(std::size_t k=stripes[s].begin; k<stripes[s].end; k++) {
+                IdxT n = stripeEmitters[k];
+                IdxT xmin, xmax, ymin, ymax;
+                trec.start();
+                const FloatT *xs = make_stencil(stripes[s].xBegin, stripes[s].xEnd-1, (points.X(n)-imageXmin)*sizeRatioX,
+                                                points.sigmaX(n)*sizeRatioX, sigmaAccuracy, table, xmin, xmax, xStencil);
+                if(!xs) continue;
+                const FloatT *ys = make_stencil(0, pixelsY-1, (points.Y(n)-imageYmin)*sizeRatioY, points.sigmaY(n)*sizeRatioY,
+                                                sigmaAccuracy, table, ymin, ymax, yStencil);
+                if(!ys) continue;
+                trec.stencil_done();
+                splat(frameIm, pixelsY, points.I(n), xmin, xmax, xs, ymin, ymax, ys);
+                trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1));
+            }
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie,
+                                                      IdxT window, IdxT stride)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::Frame});
+    renderMovieWindowed(points,roi,movie,window,stride,0,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie,
+                                                       IdxT window, IdxT stride, FloatT sigmaAccuracy)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    renderMovieWindowed(points,roi,movie,window,stride,sigmaAccuracy,true);
+}
+
+/* Render a sliding-window movie from prefix sums over the input frames.
+ *
+ * The input frames are split into blocks of window frames, and P is the sum of the frames from the start of the
+ * current block.  A window [a,a+window) starting in block [b,b+window) is P(b+window)-P(a) from its own block plus
+ * P(a+window) from the next block, so each output frame is made from at most three image additions whatever the
+ * window length, while P never holds more than one block and cancellation error stays small.
+ *
+ * Threads own column stripes of P and of the movie and sweep the input frames independently.  Emitters are binned
+ * into the stripes they overlap and each stripe renders its emitters in frame order.  Stencils are always made for
+ * the whole image and clipped to the stripe when added, so results do not depend on the number of threads.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderMovieWindowed(const PointView<PointFloatT> &points, const VecT &roi, MovieT &movie,
+                                                  IdxT window, IdxT stride, FloatT sigmaAccuracy, bool gauss)
+{
+    if(window==0 || stride==0) throw SRRenderError("BadWindow","Window length and stride must be positive");
+    IdxT pixelsX =  static_cast<IdxT>(movie.n_cols); //number of output pixels in the X direction (across rows)
+    IdxT pixelsY =  static_cast<IdxT>(movie.n_rows); //number of output pixels in the Y direction (down columns)
+    IdxT nOut = static_cast<IdxT>(movie.n_slices);
+    FloatT imageXmin = roi(0);
+    FloatT imageYmin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT N = static_cast<IdxT>(points.n_points());
+    for(IdxT n=0; n<N; n++) if(!(points.frame(n)>=0))
+        throw SRRenderError("BadFrameIndex", "Frame index "+std::to_string(points.frame(n))+" is negative.");
+    if(movie.n_elem==0) return;
+    std::size_t nIn = static_cast<std::size_t>(nOut-1)*stride + window; //Input frames covered by the windows
+
+    RenderRecorder rec(N);
+    auto frameOf = [&](IdxT n) { return static_cast<std::size_t>(points.frame(n)); };
+    auto columns = [&](IdxT n, IdxT &xmin, IdxT &xmax) {
+        if(!(points.frame(n)<nIn)) return false;
+        FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+        IdxT halfwidth = gauss ? stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, sigmaAccuracy, nullptr) : 0;
+        return stencil_span(pixelsX, X, halfwidth, xmin, xmax);
+    };
+    std::size_t nStripes = std::max<std::size_t>(1, std::min<std::size_t>(pixelsX, 4*RenderOptionsScope::threads()));
+    auto stripeBegin = [&](std::size_t s) { return static_cast<IdxT>(s*pixelsX/nStripes); };
+    auto stripeOf = [&](IdxT x) { return ((static_cast<std::size_t>(x)+1)*nStripes-1)/pixelsX; };
+    auto stripesOf = [&](IdxT n, auto add) {
+        IdxT xmin, xmax;
+        if(!columns(n, xmin, xmax)) return;
+        for(std::size_t s=stripeOf(xmin); s<=stripeOf(xmax); s++) add(s);
+    };
+    std::vector<std::size_t> stripeOffsets;
+    std::vector<IdxT> stripeEmitters;
+    bin_emitters(N, nStripes, stripesOf, stripeOffsets, stripeEmitters);
+    ImageT prefix(pixelsY, pixelsX);
+    rec.scratch(stripeOffsets.size()*sizeof(std::size_t) + stripeEmitters.size()*sizeof(IdxT) + prefix.n_elem*sizeof(FloatT));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](IdxT n) {
+        IdxT min, max;
+        FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+        IdxT halfwidth = gauss ? stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, sigmaAccuracy, nullptr) : 0;
+        return !columns(n, min, max) || !stencil_span(pixelsY, Y, halfwidth, min, max);
+    });
+    rec.restart();
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
+        VecT xStencil(pixelsX), yStencil(pixelsY);
+        std::vector<IdxT> emitters;
+        trec.alloc_done();
+        trec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+        #pragma omp for schedule(dynamic)
+        for(std::size_t s=0; s<nStripes; s++) {
+            IdxT c0 = stripeBegin(s);
+            IdxT c1 = stripeBegin(s+1);
+            std::size_t len = static_cast<std::size_t>(c1-c0)*pixelsY; //Stripe columns are contiguous
+            FloatT *P = prefix.colptr(c0);
+            auto addPrefix = [&](std::size_t k, FloatT sign) {
+                FloatT *out = movie.slice_memptr(k) + static_cast<std::size_t>(c0)*pixelsY;
+                for(std::size_t i=0; i<len; i++) out[i] += sign*P[i];
+            };
+            for(IdxT k=0; k<nOut; k++) std::fill_n(movie.slice_memptr(k) + static_cast<std::size_t>(c0)*pixelsY, len, FloatT(0));
+            emitters.assign(stripeEmitters.begin()+stripeOffsets[s], stripeEmitters.begin()+stripeOffsets[s+1]);
+            std::stable_sort(emitters.begin(), emitters.end(), [&](IdxT a, IdxT b) { return frameOf(a) < frameOf(b); });
+            std::size_t e = 0;
+            for(std::size_t f=0; f<=nIn; f++) {
+                if(f%window == 0) {
+                    //Windows starting in the block ending at f add the block sum P(f) less their start P(a)
+                    if(f>0) for(std::size_t k=(f-window+stride-1)/stride; k<std::min<std::size_t>(nOut,(f+stride-1)/stride); k++)
+                        addPrefix(k, 1);
+                    std::fill_n(P, len, FloatT(0));
+                } else {
+                    if(f%stride==0 && f/stride<nOut) addPrefix(f/stride, -1); //Window starts mid-block
+                    if(f>=window && (f-window)%stride==0) addPrefix((f-window)/stride, 1); //Window ends mid-block
+                }
+                if(f==nIn) break;
+                for(; e<emitters.size() && frameOf(emitters[e])==f; e++) {
+                    IdxT n = emitters[e];
+                    FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+                    FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+                    if(!gauss) {
+                        IdxT ix, iy;
+                        if(stencil_span(pixelsX, X, 0, ix, ix) && stencil_span(pixelsY, Y, 0, iy, iy)) {
+                            prefix(iy,ix) += points.I(n); //intensity
+                            trec.added(1);
+                        }
+                        continue;
+                    }
+                    IdxT xmin, xmax, ymin, ymax;
+                    const FloatT *xs = make_stencil(0, pixelsX-1, X, points.sigmaX(n)*sizeRatioX, sigmaAccuracy, nullptr,
+                                                    xmin, xmax, xStencil);
+                    const FloatT *ys = make_stencil(0, pixelsY-1, Y, points.sigmaY(n)*sizeRatioY, sigmaAccuracy, nullptr,
+                                                    ymin, ymax, yStencil);
+                    if(!xs || !ys) continue;
+                    IdxT lo = std::max(xmin, c0);
+                    IdxT hi = std::min(xmax, c1-1);
+                    splat(prefix.memptr(), pixelsY, points.I(n), lo, hi, xs+(lo-xmin), ymin, ymax, ys);
+                    trec.added(static_cast<std::size_t>(hi-lo+1)*(ymax-ymin+1));
+                }
+            }
         }
+        trec.splat_done(0);
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX,
+                                                    IdxT pixelsY, IdxT nFrames, const FrameSinkT &sink, IdxT framesInFlight)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::Frame});
+    renderMovieStream(points,roi,pixelsX,pixelsY,nFrames,sink,framesInFlight,0,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX,
+                                                     IdxT pixelsY, IdxT nFrames, const FrameSinkT &sink,
+                                                     FloatT sigmaAccuracy, IdxT framesInFlight)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    renderMovieStream(points,roi,pixelsX,pixelsY,nFrames,sink,framesInFlight,sigmaAccuracy,true);
+}
+
+/* Render a movie a batch of framesInFlight frames at a time, passing the finished frames to sink.
+ *
+ * The points of each batch are a contiguous run of the frame-sorted points, so frames are counted by scanning
+ * forward from the batch's first point n0 rather than binning the whole movie.  Each batch's points are then binned
+ * into frame stripes by bin_frame_stripes, with emitter indexes relative to n0, and rendered like renderGaussMovie
+ * into one of two batch buffers.  While the next batch renders into the other buffer, a writer thread passes the
+ * frames of the finished batch to sink, so the render threads never wait on the sink unless it is slower than
+ * rendering.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderMovieStream(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX,
+                                                IdxT pixelsY, IdxT nFrames, const FrameSinkT &sink,
+                                                IdxT framesInFlight, FloatT sigmaAccuracy, bool gauss)
+{
+    if(!sink) throw SRRenderError("BadFrameSink","Movie stream needs a frame sink");
+    if(pixelsX==0 || pixelsY==0) throw SRRenderError("BadImageSize","Movie frames must have at least one pixel");
+    IdxT N = static_cast<IdxT>(points.n_points());
+    for(IdxT n=0; n<N; n++) {
+        if(!(points.frame(n)>=0 && points.frame(n)<nFrames))
+            throw SRRenderError("BadFrameIndex", "Frame index "+std::to_string(points.frame(n))+
+                                " not in movie with "+std::to_string(nFrames)+" frames.");
+        if(n>0 && points.frame(n)<points.frame(n-1))
+            throw SRRenderError("UnsortedFrames", "Point "+std::to_string(n)+" has frame index "+
+                                std::to_string(points.frame(n))+" after "+std::to_string(points.frame(n-1))+
+                                ".  Movie stream points must be sorted by frame.");
+    }
+    if(nFrames==0) return;
+    IdxT batch = framesInFlight ? framesInFlight : static_cast<IdxT>(std::max(1, RenderOptionsScope::threads()));
+    batch = std::min(batch, nFrames);
+    FloatT imageXmin = roi(0);
+    FloatT imageYmin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+
+    RenderRecorder rec(N);
+    //The columns of each footprint, found without computing the stencils
+    auto columns = [&](IdxT n, IdxT &xmin, IdxT &xmax) {
+        FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+        FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+        IdxT halfwidthX = gauss ? stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, sigmaAccuracy, nullptr) : 0;
+        IdxT halfwidthY = gauss ? stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, sigmaAccuracy, nullptr) : 0;
+        IdxT ymin, ymax;
+        return stencil_span(pixelsX, X, halfwidthX, xmin, xmax) && stencil_span(pixelsY, Y, halfwidthY, ymin, ymax);
+    };
+    rec.count_clipped(N, [&](IdxT n) { IdxT xmin, xmax; return !columns(n, xmin, xmax); });
+    rec.restart();
+    MovieT buffers[2] = {MovieT(pixelsY, pixelsX, batch), MovieT(pixelsY, pixelsX, batch)};
+    rec.scratch(2*buffers[0].n_elem*sizeof(FloatT));
+    rec.lap(&RenderStats::allocSeconds);
+
+    std::thread writer;
+    std::exception_ptr sinkError;
+    auto joinWriter = [&]{
+        if(writer.joinable()) writer.join();
+        if(sinkError) std::rethrow_exception(sinkError);
+    };
+    try {
+        IdxT n0 = 0; //First point of the batch
+        for(IdxT f0=0, b=0; f0<nFrames; f0+=batch, b++) {
+            IdxT nb = std::min(batch, nFrames-f0);
+            MovieT &movie = buffers[b%2];
+            std::vector<std::size_t> frameCounts(nb, 0);
+            IdxT n = n0;
+            for(IdxT f=0; f<nb; f++) {
+                IdxT begin = n;
+                while(n<N && points.frame(n)<f0+f+1) n++;
+                frameCounts[f] = n-begin;
+            }
+            //Stripes hold indexes from n0 into the points of the batch
+            std::vector<IdxT> stripeEmitters;
+            auto stripes = bin_frame_stripes(n-n0, frameCounts, pixelsX,
+                                             [&](IdxT k) { return static_cast<IdxT>(points.frame(n0+k))-f0; },
+                                             [&](IdxT k, IdxT &xmin, IdxT &xmax) { return columns(n0+k, xmin, xmax); },
+                                             stripeEmitters);
+            rec.lap(&RenderStats::binSeconds);
+            parallel_region([&]{
+                ThreadRecorder trec(rec);
+                trec.start();
+                VecT xStencil(gauss ? pixelsX : 0), yStencil(gauss ? pixelsY : 0);
+                #pragma omp for schedule(static)
+                for(IdxT f=0; f<nb; f++) std::fill_n(movie.slice_memptr(f), movie.n_elem_slice, FloatT(0));
+                trec.alloc_done();
+                trec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+                #pragma omp for schedule(dynamic)
+                for(std::size_t s=0; s<stripes.size(); s++) {
+                    IdxT frame = stripes[s].frame;
+                    FloatT *frameIm = movie.slice_memptr(frame);
+                    for(std::size_t k=stripes[s].begin; k<stripes[s].end; k++) {
+                        IdxT e = n0+stripeEmitters[k];
+                        FloatT X = (points.X(e)-imageXmin)*sizeRatioX;
+                        FloatT Y = (points.Y(e)-imageYmin)*sizeRatioY;
+                        if(!gauss) {
+                            IdxT ix=0, iy=0;
+                            if(!stencil_span(pixelsX, X, 0, ix, ix) || !stencil_span(pixelsY, Y, 0, iy, iy)) continue;
+                            frameIm[static_cast<std::size_t>(ix)*pixelsY+iy] += points.I(e); //intensity
+                            trec.added(1);
+                            continue;
+                        }
+                        IdxT xmin, xmax, ymin, ymax;
+                        trec.start();
+                        const FloatT *xs = make_stencil(stripes[s].xBegin, stripes[s].xEnd-1, X, points.sigmaX(e)*sizeRatioX,
+                                                        sigmaAccuracy, nullptr, xmin, xmax, xStencil);
+                        if(!xs) continue;
+                        const FloatT *ys = make_stencil(0, pixelsY-1, Y, points.sigmaY(e)*sizeRatioY, sigmaAccuracy,
+                                                        nullptr, ymin, ymax, yStencil);
+                        if(!ys) continue;
+                        trec.stencil_done();
+                        splat(frameIm, pixelsY, points.I(e), xmin, xmax, xs, ymin, ymax, ys);
+                        trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1));
+                    }
+                }
+            });
+            n0 = n;
+            joinWriter(); //The previous batch is written, and its buffer is free for the next batch
+            rec.restart();
+            MovieT *frames = &movie;
+            writer = std::thread([&sink, &sinkError, frames, f0, nb]{
+                try {
+                    for(IdxT f=0; f<nb; f++) sink(f0+f, frames->slice(f));
+                } catch(...) {
+                    sinkError = std::current_exception();
+                }
+            });
+        }
+        joinWriter();
+    } catch(...) {
+        if(writer.joinable()) writer.join();
+        throw;
     }
 }
 
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::fill_stencil(IdxT size, FloatT x, FloatT sigma, VecT& stencil)
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &channels)
 {
-    FloatT norm = normexp/sigma;
-    FloatT derf = erf(-norm*x);
-    for(IdxT i=0;i<size;i++) {
-        FloatT last_derf = derf;
-        derf = erf(norm*((i+1)-x));
-        stencil(i) = 0.5*(derf-last_derf);
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::Frame});
+    ImageT weights(channels.n_slices, channels.n_slices, arma::fill::eye);
+    renderChannels(points,roi,channels,weights,0,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &channels,
+                                                  FloatT sigmaAccuracy)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    ImageT weights(channels.n_slices, channels.n_slices, arma::fill::eye);
+    renderChannels(points,roi,channels,weights,sigmaAccuracy,true);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                                 const ImageT &weights)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::Frame});
+    renderChannels(points,roi,im,weights,0,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                                  const ImageT &weights, FloatT sigmaAccuracy)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY,
+                         PointField::Frame});
+    renderChannels(points,roi,im,weights,sigmaAccuracy,true);
+}
+
+/* Render every slice of a multi-channel image in one pass over the points.
+ *
+ * Point n belongs to channel c=frame(n) and adds I*weights(c,k) to slice k.  Emitters are binned once into image
+ * tiles, and each thread renders a whole tile in every slice, computing each stencil once (clipped to the tile, as
+ * renderGaussTiled does) and adding it to every slice with a nonzero weight for its channel.  Channels with no nonzero
+ * weights are skipped when binning, and their points are counted in RenderStats as neither rendered nor clipped.
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderChannels(const PointView<PointFloatT> &points, const VecT &roi, MovieT &im,
+                                             const ImageT &weights, FloatT sigmaAccuracy, bool gauss)
+{
+    if(weights.n_cols != im.n_slices)
+        throw SRRenderError("BadChannelWeights", "Channel weights have "+std::to_string(weights.n_cols)+
+                            " columns for an image with "+std::to_string(im.n_slices)+" slices.");
+    IdxT nChannels = static_cast<IdxT>(weights.n_rows);
+    IdxT nSlices = static_cast<IdxT>(im.n_slices);
+    //The (slice, weight) pairs of each channel's nonzero weights
+    std::vector<std::size_t> channelOffsets(nChannels+1, 0);
+    std::vector<std::pair<IdxT,FloatT>> channelSlices;
+    for(IdxT c=0; c<nChannels; c++) {
+        for(IdxT k=0; k<nSlices; k++) if(weights(c,k)!=0) channelSlices.emplace_back(k, weights(c,k));
+        channelOffsets[c+1] = channelSlices.size();
+    }
+    auto channelOf = [&](IdxT n) { return static_cast<IdxT>(points.frame(n)); };
+    auto drawn = [&](IdxT n) { return channelOffsets[channelOf(n)]!=channelOffsets[channelOf(n)+1]; };
+    IdxT N = static_cast<IdxT>(points.n_points());
+    IdxT nDrawn = 0; //Points in channels with a nonzero weight
+    for(IdxT n=0; n<N; n++) {
+        if(!(points.frame(n)>=0 && points.frame(n)<nChannels))
+            throw SRRenderError("BadChannelIndex", "Channel index "+std::to_string(points.frame(n))+
+                                " not in weights for "+std::to_string(nChannels)+" channels.");
+        if(drawn(n)) nDrawn++;
+    }
+    IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
+    IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
+    if(im.n_elem==0) return;
+    FloatT imageXmin = roi(0);
+    FloatT imageYmin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT tileSize = DefaultTileSize;
+    IdxT tilesX = (pixelsX+tileSize-1)/tileSize;
+    IdxT tilesY = (pixelsY+tileSize-1)/tileSize;
+    IdxT nTiles = tilesX*tilesY;
+
+    //The pixels a point's stencil covers in the image
+    auto span = [&](IdxT n, IdxT &xmin, IdxT &xmax, IdxT &ymin, IdxT &ymax) {
+        FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+        FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+        IdxT halfwidthX = gauss ? stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, sigmaAccuracy, nullptr) : 0;
+        IdxT halfwidthY = gauss ? stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, sigmaAccuracy, nullptr) : 0;
+        return stencil_span(pixelsX, X, halfwidthX, xmin, xmax) && stencil_span(pixelsY, Y, halfwidthY, ymin, ymax);
+    };
+    auto footprint = [&](IdxT n, IdxT &xmin, IdxT &xmax, IdxT &ymin, IdxT &ymax) {
+        return drawn(n) && span(n, xmin, xmax, ymin, ymax);
+    };
+    RenderRecorder rec(nDrawn); //Points in channels with no nonzero weights are neither rendered nor clipped
+    std::vector<std::size_t> tileOffsets;
+    std::vector<IdxT> tileEmitters;
+    bin_emitters_by_tile(N, tileSize, tilesX, tilesY, footprint, tileOffsets, tileEmitters);
+    rec.scratch(tileOffsets.size()*sizeof(std::size_t) + tileEmitters.size()*sizeof(IdxT));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](std::size_t n) {
+        IdxT xmin, xmax, ymin, ymax;
+        return drawn(n) && !span(n, xmin, xmax, ymin, ymax);
+    });
+    rec.restart();
+
+    bool firstTouch = RenderOptionsScope::active().firstTouch;
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
+        VecT xStencil(tileSize), yStencil(tileSize); //Stencils are clipped to the tile
+        trec.alloc_done();
+        trec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+        auto renderTile = [&](IdxT t) {
+            IdxT tx0 = (t/tilesY)*tileSize;
+            IdxT ty0 = (t%tilesY)*tileSize;
+            IdxT tx1 = std::min(pixelsX, tx0+tileSize)-1;
+            IdxT ty1 = std::min(pixelsY, ty0+tileSize)-1;
+            trec.start();
+            for(IdxT k=0; k<nSlices; k++) {
+                FloatT *slice = im.slice_memptr(k);
+                for(IdxT x=tx0; x<=tx1; x++) std::fill_n(slice+static_cast<std::size_t>(x)*pixelsY+ty0, ty1-ty0+1, FloatT(0));
+            }
+            trec.alloc_done();
+            for(std::size_t e=tileOffsets[t]; e<tileOffsets[t+1]; e++) {
+                IdxT n = tileEmitters[e];
+                IdxT c = channelOf(n);
+                FloatT I = points.I(n); //intensity
+                if(!gauss) {
+                    IdxT ix=0, iy=0;
+                    if(!span(n, ix, ix, iy, iy)) continue;
+                    std::size_t pixel = static_cast<std::size_t>(ix)*pixelsY + iy;
+                    for(std::size_t j=channelOffsets[c]; j<channelOffsets[c+1]; j++)
+                        im.slice_memptr(channelSlices[j].first)[pixel] += I*channelSlices[j].second;
+                    trec.added(channelOffsets[c+1]-channelOffsets[c]);
+                    continue;
+                }
+                IdxT xmin, xmax, ymin, ymax;
+                trec.start();
+                const FloatT *xs = make_stencil(tx0, tx1, (points.X(n)-imageXmin)*sizeRatioX, points.sigmaX(n)*sizeRatioX,
+                                                sigmaAccuracy, nullptr, xmin, xmax, xStencil);
+                const FloatT *ys = make_stencil(ty0, ty1, (points.Y(n)-imageYmin)*sizeRatioY, points.sigmaY(n)*sizeRatioY,
+                                                sigmaAccuracy, nullptr, ymin, ymax, yStencil);
+                if(!xs || !ys) continue;
+                trec.stencil_done();
+                for(std::size_t j=channelOffsets[c]; j<channelOffsets[c+1]; j++)
+                    splat(im.slice_memptr(channelSlices[j].first), pixelsY, I*channelSlices[j].second,
+                          xmin, xmax, xs, ymin, ymax, ys);
+                trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1)*(channelOffsets[c+1]-channelOffsets[c]));
+            }
+            if(!gauss) trec.splat_done(0);
+        };
+        if(firstTouch) {
+            #pragma omp for schedule(static)
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        } else {
+            #pragma omp for schedule(dynamic)
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, IdxT tileSize)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y});
+    renderHistTiled(points,roi,im,tileSize,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, IdxT tileSize, bool accumulate)
+{
+    if(tileSize==0) throw SRRenderError("BadTileSize","Tile size must be positive");
+    IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
+    IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
+    FloatT xmin = roi(0);
+    FloatT ymin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT N = static_cast<IdxT>(points.n_points());
+    IdxT tilesX = (pixelsX+tileSize-1)/tileSize;
+    IdxT tilesY = (pixelsY+tileSize-1)/tileSize;
+    IdxT nTiles = tilesX*tilesY;
+
+    auto footprint = [&](IdxT n, IdxT &ixmin, IdxT &ixmax, IdxT &iymin, IdxT &iymax) {
+        return stencil_span(pixelsX, (points.X(n)-xmin)*sizeRatioX, 0, ixmin, ixmax) &&
+               stencil_span(pixelsY, (points.Y(n)-ymin)*sizeRatioY, 0, iymin, iymax);
+    };
+    RenderRecorder rec(N);
+    std::vector<std::size_t> tileOffsets;
+    std::vector<IdxT> tileEmitters;
+    bin_emitters_by_tile(N, tileSize, tilesX, tilesY, footprint, tileOffsets, tileEmitters);
+    rec.scratch(tileOffsets.size()*sizeof(std::size_t) + tileEmitters.size()*sizeof(IdxT));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](std::size_t n) { IdxT ix, iy; return !footprint(n, ix, ix, iy, iy); });
+    rec.restart();
+
+    bool firstTouch = RenderOptionsScope::active().firstTouch;
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        auto renderTile = [&](IdxT t) {
+            IdxT tx0 = (t/tilesY)*tileSize;
+            IdxT ty0 = (t%tilesY)*tileSize;
+            IdxT tx1 = std::min(pixelsX, tx0+tileSize);
+            IdxT ty1 = std::min(pixelsY, ty0+tileSize);
+            trec.start();
+            if(!accumulate) for(IdxT x=tx0; x<tx1; x++) for(IdxT y=ty0; y<ty1; y++) im(y,x) = 0;
+            trec.alloc_done();
+            for(std::size_t k=tileOffsets[t]; k<tileOffsets[t+1]; k++) {
+                IdxT n = tileEmitters[k];
+                IdxT ix=0, iy=0;
+                footprint(n, ix, ix, iy, iy);
+                im(iy,ix) += points.I(n); //intensity
+            }
+            trec.splat_done(tileOffsets[t+1]-tileOffsets[t]);
+        };
+        //With firstTouch each thread always renders the same tiles, so repeated renders keep their pages local
+        if(firstTouch) {
+            #pragma omp for schedule(static) nowait
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        } else {
+            #pragma omp for schedule(dynamic) nowait
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistSparse(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y});
+    std::vector<std::size_t> pixels;
+    std::vector<FloatT> values;
+    sparse_hist(points,roi,static_cast<IdxT>(im.n_cols),static_cast<IdxT>(im.n_rows),pixels,values);
+    zero_image(im);
+    FloatT *data = im.memptr();
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(std::size_t k=0; k<pixels.size(); k++) data[pixels[k]] = values[k];
+    });
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderHistSparse(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                               SpImageT &im)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y});
+    std::vector<std::size_t> pixels;
+    std::vector<FloatT> values;
+    sparse_hist(points,roi,pixelsX,pixelsY,pixels,values);
+    std::size_t nNonzero = 0;
+    for(auto &v: values) if(v!=0) nNonzero++;
+    arma::umat locations(2,nNonzero);
+    VecT nonzeros(nNonzero);
+    for(std::size_t k=0, j=0; k<pixels.size(); k++) {
+        if(values[k]==0) continue;
+        locations(0,j) = pixels[k]%pixelsY;
+        locations(1,j) = pixels[k]/pixelsY;
+        nonzeros(j++) = values[k];
     }
+    //Locations are already in column-major order and nonzero
+    im = SpImageT(locations,nonzeros,pixelsY,pixelsX,false,false);
+}
+
+/* Sum the emitters into the occupied pixels of a pixelsX x pixelsY histogram.
+ * Emitters are binned into column bands, and each thread takes whole bands, sorting their emitters by pixel index and
+ * summing runs of equal index (a segmented reduction).  Emitters are sorted by (pixel, emitter index) so each pixel
+ * sums its emitters in ascending order, exactly as renderHistSingle does.
+ * [out] pixels - column-major linear indexes of the occupied pixels in ascending order
+ * [out] values - sum of the emitter intensities in each occupied pixel
+ */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::sparse_hist(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                          std::vector<std::size_t> &pixels, std::vector<FloatT> &values)
+{
+    FloatT xmin = roi(0);
+    FloatT ymin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT N = static_cast<IdxT>(points.n_points());
+    auto pixelOf = [&](IdxT n, std::size_t &pixel) {
+        IdxT ix, iy;
+        if(!stencil_span(pixelsX, (points.X(n)-xmin)*sizeRatioX, 0, ix, ix) ||
+           !stencil_span(pixelsY, (points.Y(n)-ymin)*sizeRatioY, 0, iy, iy)) return false;
+        pixel = static_cast<std::size_t>(ix)*pixelsY + iy;
+        return true;
+    };
+    std::size_t nBands = std::max<std::size_t>(1, std::min<std::size_t>(pixelsX, 4*RenderOptionsScope::threads()));
+    auto bandOf = [&](IdxT n, auto add) {
+        std::size_t pixel;
+        if(pixelOf(n, pixel)) add(pixel/pixelsY*nBands/pixelsX);
+    };
+    RenderRecorder rec(N);
+    std::vector<std::size_t> bandOffsets;
+    std::vector<IdxT> bandEmitters;
+    bin_emitters(N, nBands, bandOf, bandOffsets, bandEmitters);
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](IdxT n) { std::size_t pixel; return !pixelOf(n, pixel); });
+    rec.restart();
+
+    std::size_t M = bandEmitters.size();
+    std::vector<std::pair<std::size_t,IdxT>> keys(M);
+    std::vector<std::size_t> bandPixels(M);
+    std::vector<FloatT> bandValues(M);
+    std::vector<std::size_t> bandCounts(nBands+1,0); //Occupied pixels in each band, then their offsets
+    rec.scratch(bandOffsets.size()*sizeof(std::size_t) + M*(sizeof(IdxT)+sizeof(keys[0])+sizeof(std::size_t)+sizeof(FloatT)));
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
+        #pragma omp for schedule(dynamic)
+        for(std::size_t b=0; b<nBands; b++) {
+            std::size_t begin = bandOffsets[b];
+            std::size_t end = bandOffsets[b+1];
+            for(std::size_t k=begin; k<end; k++) {
+                pixelOf(bandEmitters[k], keys[k].first);
+                keys[k].second = bandEmitters[k];
+            }
+            std::sort(keys.begin()+begin, keys.begin()+end);
+            std::size_t count = 0;
+            for(std::size_t k=begin; k<end; k++) {
+                if(k==begin || keys[k].first!=keys[k-1].first) {
+                    bandPixels[begin+count] = keys[k].first;
+                    bandValues[begin+count] = 0;
+                    count++;
+                }
+                bandValues[begin+count-1] += points.I(keys[k].second); //intensity
+            }
+            bandCounts[b+1] = count;
+            trec.added(end-begin);
+        }
+        trec.splat_done(0);
+    });
+    rec.restart();
+    for(std::size_t b=0; b<nBands; b++) bandCounts[b+1] += bandCounts[b];
+    pixels.resize(bandCounts[nBands]);
+    values.resize(bandCounts[nBands]);
+    parallel_region([&]{
+        #pragma omp for schedule(static)
+        for(std::size_t b=0; b<nBands; b++) {
+            std::size_t count = bandCounts[b+1]-bandCounts[b];
+            std::copy_n(bandPixels.begin()+bandOffsets[b], count, pixels.begin()+bandCounts[b]);
+            std::copy_n(bandValues.begin()+bandOffsets[b], count, values.begin()+bandCounts[b]);
+        }
+    });
+    rec.lap(&RenderStats::reduceSeconds);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy, IdxT tileSize)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGaussTiled(points,roi,im,sigmaAccuracy,nullptr,tileSize,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, const StencilTableT &table, IdxT tileSize)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGaussTiled(points,roi,im,table.get_sigma_accuracy(),&table,tileSize,false);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussTiled(const PointView<PointFloatT> &points, const VecT &roi, ImageT &im, FloatT sigmaAccuracy,
+                                               const StencilTableT *table, IdxT tileSize, bool accumulate,
+                                               const FloatT *accuracies)
+{
+    if(tileSize==0) throw SRRenderError("BadTileSize","Tile size must be positive");
+    IdxT pixelsX =  static_cast<IdxT>(im.n_cols); //number of output pixels in the X direction (across rows)
+    IdxT pixelsY =  static_cast<IdxT>(im.n_rows); //number of output pixels in the Y direction (down columns)
+    FloatT imageXmin = roi(0);
+    FloatT imageYmin = roi(2);
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    IdxT N = static_cast<IdxT>(points.n_points());
+    IdxT tilesX = (pixelsX+tileSize-1)/tileSize;
+    IdxT tilesY = (pixelsY+tileSize-1)/tileSize;
+    IdxT nTiles = tilesX*tilesY;
+
+    //Footprints are found without computing the stencils, using the same halfwidths make_stencil() will use
+    auto footprint = [&](IdxT n, IdxT &xmin, IdxT &xmax, IdxT &ymin, IdxT &ymax) {
+        FloatT X = (points.X(n)-imageXmin)*sizeRatioX;
+        FloatT Y = (points.Y(n)-imageYmin)*sizeRatioY;
+        FloatT accuracyX = point_accuracy(accuracies, sigmaAccuracy, n, 0);
+        FloatT accuracyY = point_accuracy(accuracies, sigmaAccuracy, n, 1);
+        return stencil_span(pixelsX, X, stencil_halfwidth(X, points.sigmaX(n)*sizeRatioX, accuracyX, table), xmin, xmax) &&
+               stencil_span(pixelsY, Y, stencil_halfwidth(Y, points.sigmaY(n)*sizeRatioY, accuracyY, table), ymin, ymax);
+    };
+    RenderRecorder rec(N);
+    std::vector<std::size_t> tileOffsets;
+    std::vector<IdxT> tileEmitters;
+    bin_emitters_by_tile(N, tileSize, tilesX, tilesY, footprint, tileOffsets, tileEmitters);
+    rec.scratch(tileOffsets.size()*sizeof(std::size_t) + tileEmitters.size()*sizeof(IdxT));
+    rec.lap(&RenderStats::binSeconds);
+    rec.count_clipped(N, [&](std::size_t n) { IdxT xmin, xmax, ymin, ymax; return !footprint(n, xmin, xmax, ymin, ymax); });
+    rec.restart();
+
+    bool firstTouch = RenderOptionsScope::active().firstTouch;
+    parallel_region([&]{
+        ThreadRecorder trec(rec);
+        trec.start();
+        VecT xStencil(tileSize), yStencil(tileSize); //Stencils are clipped to the tile
+        trec.alloc_done();
+        trec.scratch((xStencil.n_elem+yStencil.n_elem)*sizeof(FloatT));
+        auto renderTile = [&](IdxT t) {
+            IdxT tx0 = (t/tilesY)*tileSize;
+            IdxT ty0 = (t%tilesY)*tileSize;
+            IdxT tx1 = std::min(pixelsX, tx0+tileSize)-1;
+            IdxT ty1 = std::min(pixelsY, ty0+tileSize)-1;
+            trec.start();
+            if(!accumulate) for(IdxT x=tx0; x<=tx1; x++) for(IdxT y=ty0; y<=ty1; y++) im(y,x) = 0;
+            trec.alloc_done();
+            for(std::size_t k=tileOffsets[t]; k<tileOffsets[t+1]; k++) {
+                IdxT n = tileEmitters[k];
+                IdxT xmin, xmax, ymin, ymax;
+                trec.start();
+                const FloatT *xs = make_stencil(tx0, tx1, (points.X(n)-imageXmin)*sizeRatioX, points.sigmaX(n)*sizeRatioX,
+                                                point_accuracy(accuracies, sigmaAccuracy, n, 0), table, xmin, xmax, xStencil);
+                const FloatT *ys = make_stencil(ty0, ty1, (points.Y(n)-imageYmin)*sizeRatioY, points.sigmaY(n)*sizeRatioY,
+                                                point_accuracy(accuracies, sigmaAccuracy, n, 1), table, ymin, ymax, yStencil);
+                if(!xs || !ys) continue;
+                trec.stencil_done();
+                //Copy in the part of the gaussian within this tile
+                splat(im.memptr(), pixelsY, points.I(n), xmin, xmax, xs, ymin, ymax, ys);
+                trec.splat_done(static_cast<std::size_t>(xmax-xmin+1)*(ymax-ymin+1));
+            }
+        };
+        if(firstTouch) {
+            #pragma omp for schedule(static)
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        } else {
+            #pragma omp for schedule(dynamic)
+            for(IdxT t=0; t<nTiles; t++) renderTile(t);
+        }
+    });
 }
-/*
+
 template<class FloatT, class IdxT>
-void SRRender2D<FloatT,IdxT>::checkPoints(const EmitterVecT &points) const
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                 IdxT nLevels, PyramidT &pyramid, FloatT sigmaAccuracy)
 {
-    IdxT nPoints = points.n_rows;
-    for(IdxT n=0; n<nPoints; n++){
-        assert(points(n,0)>0);
-        assert(points(n,1)>=0 && points(n,1)<size(0));
-        assert(points(n,2)>=0 && points(n,2)<size(1));
-        assert(points(n,3)>0);
-        assert(points(n,4)>0);
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGaussPyramid(points,roi,pixelsX,pixelsY,nLevels,pyramid,sigmaAccuracy,nullptr);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                 IdxT nLevels, PyramidT &pyramid, const StencilTableT &table)
+{
+    checkPoints(points, {PointField::I, PointField::X, PointField::Y, PointField::SigmaX, PointField::SigmaY});
+    renderGaussPyramid(points,roi,pixelsX,pixelsY,nLevels,pyramid,table.get_sigma_accuracy(),&table);
+}
+
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::renderGaussPyramid(const PointView<PointFloatT> &points, const VecT &roi, IdxT pixelsX, IdxT pixelsY,
+                                                 IdxT nLevels, PyramidT &pyramid, FloatT sigmaAccuracy,
+                                                 const StencilTableT *table)
+{
+    //The coarsest useful level is one pixel along the longer side.  More levels only pad the finest level.
+    IdxT maxLevels = 1;
+    while(maxLevels<32 && (std::uint64_t(1)<<(maxLevels-1)) < std::max(pixelsX,pixelsY)) maxLevels++;
+    if(nLevels==0 || nLevels>maxLevels)
+        throw SRRenderError("BadPyramidLevels","Number of pyramid levels must be in [1,"+std::to_string(maxLevels)+
+                            "] for a "+std::to_string(pixelsX)+"x"+std::to_string(pixelsY)+" image");
+    //Pad the finest level so the pixels of every level are exactly 2x2 blocks of the level below
+    IdxT scale = IdxT(1)<<(nLevels-1);
+    IdxT padX = (pixelsX+scale-1)/scale*scale;
+    IdxT padY = (pixelsY+scale-1)/scale*scale;
+    ImageT fine(padY,padX);
+    VecT padRoi = pyramidROI(roi,pixelsX,pixelsY,nLevels-1);
+    renderGauss(points,padRoi,fine,sigmaAccuracy,table,Engine::Auto);
+
+    pyramid.set_size(nLevels);
+    for(IdxT level=0; level<nLevels; level++) {
+        if(level>0) {
+            ImageT coarse(fine.n_rows/2, fine.n_cols/2);
+            parallel_region([&]{
+                #pragma omp for
+                for(IdxT x=0; x<coarse.n_cols; x++) for(IdxT y=0; y<coarse.n_rows; y++)
+                    coarse(y,x) = (fine(2*y,2*x) + fine(2*y+1,2*x)) + (fine(2*y,2*x+1) + fine(2*y+1,2*x+1));
+            });
+            fine = std::move(coarse);
+        }
+        IdxT levelX = (pixelsX+(IdxT(1)<<level)-1)>>level;
+        IdxT levelY = (pixelsY+(IdxT(1)<<level)-1)>>level;
+        ImageT &im = pyramid(level);
+        im.set_size(levelY,levelX);
+        for(IdxT x=0; x<levelX; x++) std::copy(fine.colptr(x), fine.colptr(x)+levelY, im.colptr(x));
     }
-}*/
+}
 
-/* Explicit Template Instantiation */
-template class SRRender2D<float>;
-template class SRRender2D<double>;
+/* The ROI covered by pyramid level with pixels exactly 2^level times the size of the level 0 pixels */
+template<class FloatT, class IdxT>
+typename SRRender2D<FloatT,IdxT>::VecT
+SRRender2D<FloatT,IdxT>::pyramidROI(const VecT &roi, IdxT pixelsX, IdxT pixelsY, IdxT level)
+{
+    IdxT scale = IdxT(1)<<level;
+    IdxT levelX = (pixelsX+scale-1)/scale;
+    IdxT levelY = (pixelsY+scale-1)/scale;
+    FloatT width = (roi(1)-roi(0))/pixelsX * (static_cast<FloatT>(levelX)*scale);
+    FloatT height = (roi(3)-roi(2))/pixelsY * (static_cast<FloatT>(levelY)*scale);
+    return VecT({roi(0), roi(0)+width, roi(2), roi(2)+height});
+}
 
+/* Cut a pyramid level into tileSize x tileSize tiles.  Tile (ty,tx) has its (0,0) pixel at level pixel
+ * (ty*tileSize,tx*tileSize) and tiles on the far edges are zero padded.
+ */
+template<class FloatT, class IdxT>
+arma::field<typename SRRender2D<FloatT,IdxT>::ImageT>
+SRRender2D<FloatT,IdxT>::pyramidTiles(const ImageT &level, IdxT tileSize)
+{
+    if(tileSize==0) throw SRRenderError("BadTileSize","Tile size must be positive");
+    IdxT tilesX = (static_cast<IdxT>(level.n_cols)+tileSize-1)/tileSize;
+    IdxT tilesY = (static_cast<IdxT>(level.n_rows)+tileSize-1)/tileSize;
+    arma::field<ImageT> tiles(tilesY,tilesX);
+    parallel_region([&]{
+        #pragma omp for
+        for(IdxT tx=0; tx<tilesX; tx++) for(IdxT ty=0; ty<tilesY; ty++) {
+            ImageT tile(tileSize,tileSize,arma::fill::zeros);
+            IdxT x0 = tx*tileSize;
+            IdxT y0 = ty*tileSize;
+            IdxT nx = std::min<IdxT>(tileSize, static_cast<IdxT>(level.n_cols)-x0);
+            IdxT ny = std::min<IdxT>(tileSize, static_cast<IdxT>(level.n_rows)-y0);
+            for(IdxT x=0; x<nx; x++) std::copy(level.colptr(x0+x)+y0, level.colptr(x0+x)+y0+ny, tile.colptr(x));
+            tiles(ty,tx) = std::move(tile);
+        }
+    });
+    return tiles;
+}
 
-/*
+/* Fill stencil(0...size-1) with the pixel-integrated Gaussian for an emitter at x relative to the first pixel.
+ * The erf values at the size+1 pixel edges are evaluated with the vectorized erf kernel in place in stencil, then
+ * differenced from the back so stencil only needs to hold size values.
+ */
 template<class FloatT, class IdxT>
-SRRenderHS<FloatT>::SRRenderHS(const VecT &_size) : size(_size) {}
+void SRRender2D<FloatT,IdxT>::fill_stencil(IdxT size, FloatT x, FloatT sigma, VecT& stencil)
+{
+    if(size==0) return;
+    FloatT norm = normexp/sigma;
+    FloatT *derf = stencil.memptr();
+    FloatT first_derf = -norm*x;
+    kernels::erf_array<FloatT>(1, &first_derf, &first_derf);
+    for(IdxT i=0;i<size;i++) derf[i] = norm*((i+1)-x);
+    kernels::erf_array<FloatT>(size, derf, derf);
+    for(IdxT i=size-1; i>0; i--) derf[i] = 0.5*(derf[i]-derf[i-1]);
+    derf[0] = 0.5*(derf[0]-first_derf);
+}
 
+/* The halfwidth make_stencil() uses for an emitter at pixel coordinate X with width sigma (in output pixels) */
+template<class FloatT, class IdxT>
+IdxT SRRender2D<FloatT,IdxT>::stencil_halfwidth(FloatT X, FloatT sigma, FloatT sigmaAccuracy, const StencilTableT *table)
+{
+    IdxT halfwidth;
+    if(!table || !table->lookup(X, sigma, halfwidth)) halfwidth = static_cast<IdxT>(0.5+sigmaAccuracy*sigma);
+    return halfwidth;
+}
 
+/* The sigmaAccuracy along axis (0: X, 1: Y) for point n: from the per-point accuracies if given, else sigmaAccuracy */
+template<class FloatT, class IdxT>
+FloatT SRRender2D<FloatT,IdxT>::point_accuracy(const FloatT *accuracies, FloatT sigmaAccuracy, std::size_t n, int axis)
+{
+    return accuracies ? accuracies[2*n+axis] : sigmaAccuracy;
+}
 
+/* Make the stencil along one axis for an emitter at pixel coordinate X with width sigma (in output pixels),
+ * clipped to the pixels [clipMin,clipMax].  Stencils are looked up in table if given and it covers sigma,
+ * otherwise they are computed exactly into the stencil buffer, which must hold clipMax-clipMin+1 values.
+ *
+ * Returns a pointer to the stencil values for pixels [min,max], or nullptr if the stencil misses the clip region.
+ */
 template<class FloatT, class IdxT>
-void SRRenderHS<FloatT>::renderHist(const EmitterVecT &points, ImageT &im)
+const FloatT* SRRender2D<FloatT,IdxT>::make_stencil(IdxT clipMin, IdxT clipMax, FloatT X, FloatT sigma, FloatT sigmaAccuracy,
+                                                   const StencilTableT *table, IdxT &min, IdxT &max, VecT &stencil)
 {
-    for(unsigned n=0; n<points.n_cols; n++) im(points(n,2), points(n,3), points(n,4)) += points(n,1);
-}*/
+    IdxT halfwidth;
+    const FloatT *tabled = table ? table->lookup(X, sigma, halfwidth) : nullptr;
+    if(!tabled) halfwidth = static_cast<IdxT>(0.5+sigmaAccuracy*sigma); //halfwidth for gaussian
+    if(!stencil_span(clipMax+1, X, halfwidth, min, max) || max<clipMin) return nullptr;
+    min = std::max(min, clipMin);
+    //Table stencils start at pixel floor(X)-halfwidth
+    if(tabled) return tabled + (static_cast<std::ptrdiff_t>(min) + halfwidth - static_cast<std::ptrdiff_t>(std::floor(X)));
+    fill_stencil(max-min+1, X-min, sigma, stencil);
+    return stencil.memptr();
+}
+
+/* Add I times the outer product of the stencils into the column-major image im with leading dimension ld,
+ * covering pixels x in [xmin,xmax] and y in [ymin,ymax].
+ */
+template<class FloatT, class IdxT>
+void SRRender2D<FloatT,IdxT>::splat(FloatT *im, IdxT ld, FloatT I, IdxT xmin, IdxT xmax, const FloatT *xStencil,
+                                    IdxT ymin, IdxT ymax, const FloatT *yStencil)
+{
+    kernels::splat_rank1<FloatT>(im + ymin + static_cast<std::size_t>(xmin)*ld, ld, xmax-xmin+1, ymax-ymin+1, I, xStencil, yStencil);
+}
+
+/* Find the pixels [min,max] covered by a stencil of the given halfwidth centered on the pixel containing X, clipped
+ * to an image with the given number of pixels.  Returns false if the stencil does not overlap the image.
+ */
+template<class FloatT, class IdxT>
+bool SRRender2D<FloatT,IdxT>::stencil_span(IdxT pixels, FloatT X, IdxT halfwidth, IdxT &min, IdxT &max)
+{
+    if(!std::isfinite(X)) return false;
+    FloatT p = std::floor(X);
+    FloatT lo = p-halfwidth;
+    FloatT hi = p+halfwidth;
+    if(pixels==0 || hi<0 || lo>=pixels) return false;
+    min = lo<=0 ? 0 : static_cast<IdxT>(lo);
+    max = hi>=pixels-1 ? pixels-1 : static_cast<IdxT>(hi);
+    return true;
+}
+/* Check points has all the given fields set, throwing an SRRenderError naming the first missing one. */
+template<class FloatT, class IdxT>
+template<class PointFloatT>
+void SRRender2D<FloatT,IdxT>::checkPoints(const PointView<PointFloatT> &points, std::initializer_list<PointField> fields)
+{
+    static const char* fieldNames[] = {"I", "X", "Y", "sigmaX", "sigmaY", "Frame"};
+    if(points.n_points()==0) return; //Empty matrices have no column memory, and no points need no fields
+    for(auto field: fields) if(!points.has(field))
+        throw SRRenderError("BadPoints", std::string("Points are missing the ")+fieldNames[static_cast<int>(field)]+" field.");
+}
+
+/* Explicit Template Instantiation */
+template class SRRender2D<float>;
+template class SRRender2D<double>;
+
+/* Explicit instantiation of the PointView interface for each image and point precision.
+ * The private accumulating engines are also used by SRAccumulator2D.
+ */
+#define SRRENDER_INSTANTIATE_POINTVIEW(FloatT, PointFloatT) \
+template void SRRender2D<FloatT>::renderHist(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                             SRRender2D<FloatT>::Engine); \
+template void SRRender2D<FloatT>::renderGauss(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, FloatT, \
+                                              SRRender2D<FloatT>::Engine); \
+template void SRRender2D<FloatT>::renderHistMovie(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussMovie(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&, FloatT); \
+template void SRRender2D<FloatT>::renderHistMovieWindowed(const PointView<PointFloatT>&, const arma::Col<FloatT>&, \
+                                                          arma::Cube<FloatT>&, uint32_t, uint32_t); \
+template void SRRender2D<FloatT>::renderGaussMovieWindowed(const PointView<PointFloatT>&, const arma::Col<FloatT>&, \
+                                                           arma::Cube<FloatT>&, uint32_t, uint32_t, FloatT); \
+template void SRRender2D<FloatT>::renderHistMovieStream(const PointView<PointFloatT>&, const arma::Col<FloatT>&, uint32_t, \
+                                                        uint32_t, uint32_t, const SRRender2D<FloatT>::FrameSinkT&, uint32_t); \
+template void SRRender2D<FloatT>::renderGaussMovieStream(const PointView<PointFloatT>&, const arma::Col<FloatT>&, uint32_t, \
+                                                         uint32_t, uint32_t, const SRRender2D<FloatT>::FrameSinkT&, FloatT, \
+                                                         uint32_t); \
+template void SRRender2D<FloatT>::renderHistChannels(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussChannels(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&, \
+                                                      FloatT); \
+template void SRRender2D<FloatT>::renderHistChannels(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&, \
+                                                     const arma::Mat<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussChannels(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&, \
+                                                      const arma::Mat<FloatT>&, FloatT); \
+template void SRRender2D<FloatT>::renderHistTiled(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, uint32_t); \
+template void SRRender2D<FloatT>::renderHistSparse(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&); \
+template void SRRender2D<FloatT>::renderHistSparse(const PointView<PointFloatT>&, const arma::Col<FloatT>&, uint32_t, uint32_t, \
+                                                   arma::SpMat<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussTiled(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, FloatT, uint32_t); \
+template void SRRender2D<FloatT>::renderGauss(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                              const StencilTable<FloatT>&, SRRender2D<FloatT>::Engine); \
+template void SRRender2D<FloatT>::renderGauss(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                              const SRRender2D<FloatT>::ErrorBudget&, SRRender2D<FloatT>::Engine); \
+template void SRRender2D<FloatT>::renderGaussMovie(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Cube<FloatT>&, \
+                                                   const StencilTable<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussTiled(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                                   const StencilTable<FloatT>&, uint32_t); \
+template void SRRender2D<FloatT>::renderGaussPyramid(const PointView<PointFloatT>&, const arma::Col<FloatT>&, uint32_t, uint32_t, \
+                                                     uint32_t, arma::field<arma::Mat<FloatT>>&, FloatT); \
+template void SRRender2D<FloatT>::renderGaussPyramid(const PointView<PointFloatT>&, const arma::Col<FloatT>&, uint32_t, uint32_t, \
+                                                     uint32_t, arma::field<arma::Mat<FloatT>>&, const StencilTable<FloatT>&); \
+template void SRRender2D<FloatT>::renderHistSingle(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&); \
+template void SRRender2D<FloatT>::renderGaussSingle(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                                    FloatT, const StencilTable<FloatT>*, const FloatT*); \
+template void SRRender2D<FloatT>::renderHistTiled(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                                  uint32_t, bool); \
+template void SRRender2D<FloatT>::renderGaussTiled(const PointView<PointFloatT>&, const arma::Col<FloatT>&, arma::Mat<FloatT>&, \
+                                                   FloatT, const StencilTable<FloatT>*, uint32_t, bool, const FloatT*); \
+template void SRRender2D<FloatT>::checkPoints(const PointView<PointFloatT>&, std::initializer_list<PointField>);
+
+SRRENDER_INSTANTIATE_POINTVIEW(float, float)
+SRRENDER_INSTANTIATE_POINTVIEW(float, double)
+SRRENDER_INSTANTIATE_POINTVIEW(double, float)
+SRRENDER_INSTANTIATE_POINTVIEW(double, double)
+#undef SRRENDER_INSTANTIATE_POINTVIEW
 
 } /* namespace srrender */
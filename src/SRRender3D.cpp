@@ -0,0 +1,148 @@
+/** @file SRRender3D.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definition and template Specializations for SRRender3D.
+ *
+ * Volumetric rendering of 3D SR emitter localizations
+ */
+#include <omp.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "SRRender/SRRender3D.h"
+#include "SRRender/BinEmitters.h"
+
+namespace srrender {
+
+namespace {
+
+/* Bin N emitters into the slabs of slabSize z-slices overlapped by their z-span.
+ * span(n, zmin, zmax) gives the clipped z-slices of emitter n and returns false if the emitter misses the volume.
+ * Slab s holds slabEmitters[slabOffsets[s] ... slabOffsets[s+1]-1].
+ */
+template<class IdxT, class SpanFuncT>
+void bin_emitters_by_slab(IdxT N, IdxT slabSize, IdxT nSlabs, SpanFuncT span,
+                          std::vector<std::size_t> &slabOffsets, std::vector<IdxT> &slabEmitters)
+{
+    auto slabsOf = [&](IdxT n, auto add) {
+        IdxT zmin, zmax;
+        if(!span(n, zmin, zmax)) return;
+        for(IdxT s=zmin/slabSize; s<=zmax/slabSize; s++) add(s);
+    };
+    binning::bin_emitters(N, nSlabs, slabsOf, slabOffsets, slabEmitters);
+}
+
+} /* namespace */
+
+template<class FloatT, class IdxT>
+const FloatT SRRender3D<FloatT,IdxT>::DefaultSigmaAccuracy = 5.;
+
+template<class FloatT, class IdxT>
+const IdxT SRRender3D<FloatT,IdxT>::DefaultSlabSize = 4;
+
+template<class FloatT, class IdxT>
+void SRRender3D<FloatT,IdxT>::renderHist(const EmitterVecT &points, const VecT &roi, VolumeT &vol)
+{
+    checkPoints(points, roi, 4);
+    IdxT pixelsX = static_cast<IdxT>(vol.n_cols); //number of output voxels in the X direction (across rows)
+    IdxT pixelsY = static_cast<IdxT>(vol.n_rows); //number of output voxels in the Y direction (down columns)
+    IdxT pixelsZ = static_cast<IdxT>(vol.n_slices); //number of output voxels in the Z direction (across slices)
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    FloatT sizeRatioZ = static_cast<FloatT>(pixelsZ) / (roi(5)-roi(4));
+    IdxT N = static_cast<IdxT>(points.n_rows);
+    auto voxel = [&](IdxT n, IdxT &ix, IdxT &iy, IdxT &iz) {
+        return RenderT::stencil_span(pixelsX, (points(n,1)-roi(0))*sizeRatioX, 0, ix, ix) &&
+               RenderT::stencil_span(pixelsY, (points(n,2)-roi(2))*sizeRatioY, 0, iy, iy) &&
+               RenderT::stencil_span(pixelsZ, (points(n,3)-roi(4))*sizeRatioZ, 0, iz, iz);
+    };
+    IdxT nSlabs = (pixelsZ+DefaultSlabSize-1)/DefaultSlabSize;
+    std::vector<std::size_t> slabOffsets;
+    std::vector<IdxT> slabEmitters;
+    auto span = [&](IdxT n, IdxT &zmin, IdxT &zmax) {
+        IdxT ix, iy;
+        if(!voxel(n, ix, iy, zmin)) return false;
+        zmax = zmin;
+        return true;
+    };
+    bin_emitters_by_slab(N, DefaultSlabSize, nSlabs, span, slabOffsets, slabEmitters);
+    parallel_region([&]{
+        #pragma omp for schedule(dynamic)
+        for(IdxT s=0; s<nSlabs; s++) {
+            IdxT z0 = s*DefaultSlabSize;
+            IdxT z1 = std::min(pixelsZ, z0+DefaultSlabSize);
+            //Zero the slab in the thread that renders it
+            std::fill(vol.slice_memptr(z0), vol.slice_memptr(z0)+static_cast<std::size_t>(z1-z0)*vol.n_elem_slice, FloatT(0));
+            for(std::size_t k=slabOffsets[s]; k<slabOffsets[s+1]; k++) {
+                IdxT n = slabEmitters[k];
+                IdxT ix, iy, iz;
+                voxel(n, ix, iy, iz);
+                vol(iy,ix,iz) += points(n,0); //intensity
+            }
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+void SRRender3D<FloatT,IdxT>::renderGauss(const EmitterVecT &points, const VecT &roi, VolumeT &vol, FloatT sigmaAccuracy)
+{
+    checkPoints(points, roi, 7);
+    IdxT pixelsX = static_cast<IdxT>(vol.n_cols); //number of output voxels in the X direction (across rows)
+    IdxT pixelsY = static_cast<IdxT>(vol.n_rows); //number of output voxels in the Y direction (down columns)
+    IdxT pixelsZ = static_cast<IdxT>(vol.n_slices); //number of output voxels in the Z direction (across slices)
+    FloatT sizeRatioX = static_cast<FloatT>(pixelsX) / (roi(1)-roi(0));
+    FloatT sizeRatioY = static_cast<FloatT>(pixelsY) / (roi(3)-roi(2));
+    FloatT sizeRatioZ = static_cast<FloatT>(pixelsZ) / (roi(5)-roi(4));
+    IdxT N = static_cast<IdxT>(points.n_rows);
+    auto span = [&](IdxT n, IdxT &zmin, IdxT &zmax) {
+        IdxT min, max;
+        FloatT X = (points(n,1)-roi(0))*sizeRatioX;
+        FloatT Y = (points(n,2)-roi(2))*sizeRatioY;
+        FloatT Z = (points(n,3)-roi(4))*sizeRatioZ;
+        return RenderT::stencil_span(pixelsX, X, RenderT::stencil_halfwidth(X, points(n,4)*sizeRatioX, sigmaAccuracy, nullptr), min, max) &&
+               RenderT::stencil_span(pixelsY, Y, RenderT::stencil_halfwidth(Y, points(n,5)*sizeRatioY, sigmaAccuracy, nullptr), min, max) &&
+               RenderT::stencil_span(pixelsZ, Z, RenderT::stencil_halfwidth(Z, points(n,6)*sizeRatioZ, sigmaAccuracy, nullptr), zmin, zmax);
+    };
+    IdxT nSlabs = (pixelsZ+DefaultSlabSize-1)/DefaultSlabSize;
+    std::vector<std::size_t> slabOffsets;
+    std::vector<IdxT> slabEmitters;
+    bin_emitters_by_slab(N, DefaultSlabSize, nSlabs, span, slabOffsets, slabEmitters);
+    parallel_region([&]{
+        VecT xStencil(pixelsX), yStencil(pixelsY), zStencil(pixelsZ);
+        #pragma omp for schedule(dynamic)
+        for(IdxT s=0; s<nSlabs; s++) {
+            IdxT z0 = s*DefaultSlabSize;
+            IdxT z1 = std::min(pixelsZ, z0+DefaultSlabSize);
+            //Zero the slab in the thread that renders it
+            std::fill(vol.slice_memptr(z0), vol.slice_memptr(z0)+static_cast<std::size_t>(z1-z0)*vol.n_elem_slice, FloatT(0));
+            for(std::size_t k=slabOffsets[s]; k<slabOffsets[s+1]; k++) {
+                IdxT n = slabEmitters[k];
+                //Stencils always cover the whole volume so their values do not depend on the slab
+                IdxT xmin, xmax, ymin, ymax, zmin, zmax;
+                const FloatT *xs = RenderT::make_stencil(0, pixelsX-1, (points(n,1)-roi(0))*sizeRatioX, points(n,4)*sizeRatioX,
+                                                         sigmaAccuracy, nullptr, xmin, xmax, xStencil);
+                const FloatT *ys = RenderT::make_stencil(0, pixelsY-1, (points(n,2)-roi(2))*sizeRatioY, points(n,5)*sizeRatioY,
+                                                         sigmaAccuracy, nullptr, ymin, ymax, yStencil);
+                const FloatT *zs = RenderT::make_stencil(0, pixelsZ-1, (points(n,3)-roi(4))*sizeRatioZ, points(n,6)*sizeRatioZ,
+                                                         sigmaAccuracy, nullptr, zmin, zmax, zStencil);
+                if(!xs || !ys || !zs) continue;
+                for(IdxT z=std::max(zmin,z0); z<=std::min(zmax,z1-1); z++)
+                    RenderT::splat(vol.slice_memptr(z), pixelsY, points(n,0)*zs[z-zmin], xmin, xmax, xs, ymin, ymax, ys);
+            }
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+void SRRender3D<FloatT,IdxT>::checkPoints(const EmitterVecT &points, const VecT &roi, IdxT nColumns)
+{
+    if(points.n_rows>0 && points.n_cols<nColumns)
+        throw SRRenderError("BadPoints", "Points must have at least "+std::to_string(nColumns)+" columns.");
+    if(roi.n_elem!=6) throw SRRenderError("BadROI","ROI must be [xmin, xmax, ymin, ymax, zmin, zmax]");
+}
+
+/* Explicit Template Instantiation */
+template class SRRender3D<float>;
+template class SRRender3D<double>;
+
+} /* namespace srrender */
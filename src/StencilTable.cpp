@@ -0,0 +1,72 @@
+/** @file StencilTable.cpp
+ * @author Mark J. Olah (mjo\@cs.unm DOT edu)
+ * @date 2014-2019
+ * @brief The class definition and template Specializations for StencilTable.
+ */
+#include "SRRender/StencilTable.h"
+#include "SRRender/SRRender.h"
+
+namespace srrender {
+
+template<class FloatT, class IdxT>
+StencilTable<FloatT,IdxT>::StencilTable(FloatT sigmaMin, FloatT sigmaMax, IdxT sigmaLevels, IdxT offsetLevels, FloatT sigmaAccuracy)
+    : sigma_min(sigmaMin), sigma_max(sigmaMax), sigma_levels(sigmaLevels), offset_levels(offsetLevels), sigma_accuracy(sigmaAccuracy)
+{
+    if(!(sigmaMin>0) || !(sigmaMax>sigmaMin) || !std::isfinite(sigmaMax))
+        throw SRRenderError("BadSigmaRange","StencilTable requires 0 < sigmaMin < sigmaMax");
+    if(sigmaLevels<2) throw SRRenderError("BadSigmaLevels","StencilTable requires at least 2 sigma levels");
+    if(offsetLevels<1) throw SRRenderError("BadOffsetLevels","StencilTable requires at least 1 offset level");
+    if(!(sigmaAccuracy>0)) throw SRRenderError("BadSigmaAccuracy","sigmaAccuracy must be positive");
+
+    log_sigma_min = std::log(sigmaMin);
+    FloatT logRatio = (std::log(sigmaMax)-log_sigma_min)/(sigmaLevels-1);
+    inv_log_ratio = 1/logRatio;
+    log_lookup_min = log_sigma_min - logRatio/2;
+    log_lookup_max = std::log(sigmaMax) + logRatio/2;
+
+    level_halfwidth.resize(sigmaLevels);
+    level_start.resize(sigmaLevels+1);
+    level_start[0] = 0;
+    for(IdxT j=0; j<sigmaLevels; j++) {
+        FloatT sigma = std::exp(log_sigma_min + j*logRatio);
+        level_halfwidth[j] = static_cast<IdxT>(0.5+sigmaAccuracy*sigma);
+        level_start[j+1] = level_start[j] + static_cast<std::size_t>(offsetLevels)*(2*level_halfwidth[j]+1);
+    }
+    stencils.set_size(level_start[sigmaLevels]);
+
+    parallel_region([&]{
+        VecT stencil;
+        #pragma omp for schedule(dynamic)
+        for(IdxT j=0; j<sigmaLevels; j++) {
+            FloatT sigma = std::exp(log_sigma_min + j*logRatio);
+            IdxT size = 2*level_halfwidth[j]+1;
+            stencil.set_size(size);
+            for(IdxT o=0; o<offsetLevels; o++) {
+                FloatT x = level_halfwidth[j] + (o+0.5)/offsetLevels; //Emitter position relative to the first pixel
+                SRRender2D<FloatT,IdxT>::fill_stencil(size, x, sigma, stencil);
+                std::copy(stencil.memptr(), stencil.memptr()+size, stencils.memptr()+level_start[j]+static_cast<std::size_t>(o)*size);
+            }
+        }
+    });
+}
+
+template<class FloatT, class IdxT>
+FloatT StencilTable<FloatT,IdxT>::errorBound() const
+{
+    return errorBound(sigma_min, sigma_max, sigma_levels, offset_levels);
+}
+
+template<class FloatT, class IdxT>
+FloatT StencilTable<FloatT,IdxT>::errorBound(FloatT sigmaMin, FloatT sigmaMax, IdxT sigmaLevels, IdxT offsetLevels)
+{
+    const double phi1 = 0.24197072451914337; //Standard normal density at 1
+    const double sqrt2pi = 2.5066282746310002;
+    double sqrtRatio = std::exp(std::log(static_cast<double>(sigmaMax)/sigmaMin)/(2*(sigmaLevels-1.)));
+    return static_cast<FloatT>(sqrtRatio/(2*offsetLevels*sigmaMin*sqrt2pi) + 2*phi1*(sqrtRatio-1));
+}
+
+/* Explicit Template Instantiation */
+template class StencilTable<float>;
+template class StencilTable<double>;
+
+} /* namespace srrender */
@@ -1,31 +1,609 @@
 #include "SRRender/SRRender.h"
+#include "SRRender/SRAccumulator2D.h"
+#include "SRRender/SRAsyncRender2D.h"
+#include "SRRender/SRIndexedRender2D.h"
+#include "SRRender/SRRender3D.h"
+#include "SRRender/Kernels.h"
+#include <cstdio>
+#include <cstring>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 using namespace arma;
 using namespace std;
 using namespace srrender;
 
-void test2D()
+mat simulatePoints(int nPoints, double size, double sigma)
 {
-    vec roi={0., 256., 0., 256.};
-    int nPoints=1e5;
     default_random_engine generator;
-    uniform_real_distribution<double> xDist(0.,256.);
-    uniform_real_distribution<double> yDist(0.,256.);
+    uniform_real_distribution<double> xDist(0.,size);
+    uniform_real_distribution<double> yDist(0.,size);
     mat points(nPoints,5);
     for(int n=0; n<nPoints; n++){
         points(n,0)=1.;
         points(n,1)=xDist(generator);
         points(n,2)=yDist(generator);
-        points(n,3)=0.5;
-        points(n,4)=0.5;
+        points(n,3)=sigma;
+        points(n,4)=sigma;
     }
+    return points;
+}
+
+void checkClose(const mat &a, const mat &b, double tol, const char *name)
+{
+    double err = abs(a-b).max();
+    if(err>tol) throw SRRenderError("TestFailure", string(name)+" max error: "+to_string(err));
+}
+
+/* Throw a TestFailure with message failure unless func() throws an ExceptionT */
+template<class ExceptionT=SRRenderError, class FuncT>
+void expect_throws(FuncT func, const char *failure)
+{
+    try { func(); }
+    catch(ExceptionT &) { return; }
+    throw SRRenderError("TestFailure", failure);
+}
+
+void test2D()
+{
+    vec roi={0., 256., 0., 256.};
+    mat points = simulatePoints(1e5, 256., 0.5);
     typename SRRender2D<double>::ImageT im(2048,2048);
     SRRender2D<double>::renderGauss(points, roi, im, 5.);
 }
 
+void test2DTiled()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(200, 48., 0.3);
+    mat im(300,400), tiled(300,400);
+    SRRender2D<double>::renderGauss(points, roi, im, 5.);
+    SRRender2D<double>::renderGaussTiled(points, roi, tiled, 5., 64);
+    checkClose(im, tiled, 1e-12, "renderGaussTiled");
+    im.zeros();
+    SRRender2D<double>::renderHist(points, roi, im);
+    SRRender2D<double>::renderHistTiled(points, roi, tiled, 64);
+    checkClose(im, tiled, 1e-12, "renderHistTiled");
+    for(auto engine: {SRRender2D<double>::Engine::Single, SRRender2D<double>::Engine::Parallel, SRRender2D<double>::Engine::Tiled}) {
+        SRRender2D<double>::renderGauss(points, roi, im, 5.);
+        SRRender2D<double>::renderGauss(points, roi, tiled, 5., engine);
+        checkClose(im, tiled, 1e-12, "renderGauss Engine");
+        SRRender2D<double>::renderHist(points, roi, im);
+        SRRender2D<double>::renderHist(points, roi, tiled, engine);
+        checkClose(im, tiled, 1e-12, "renderHist Engine");
+    }
+}
+
+void test2DHistSparse()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(5000, 48., 0.3); //Many points share pixels in a 20 x 15 image
+    points(0,1) = -1.;
+    mat im(15,20), sparse(15,20);
+    SRRender2D<double>::renderHist(points, roi, im, SRRender2D<double>::Engine::Single);
+    SRRender2D<double>::renderHistSparse(points, roi, sparse);
+    checkClose(im, sparse, 0., "renderHistSparse");
+    sp_mat spIm;
+    SRRender2D<double>::renderHistSparse(points, roi, 20, 15, spIm);
+    uword nOccupied = 0;
+    for(uword x=0; x<20; x++) for(uword y=0; y<15; y++) {
+        if(spIm(y,x)!=im(y,x)) throw SRRenderError("TestFailure", "renderHistSparse SpMat value");
+        if(im(y,x)!=0) nOccupied++;
+    }
+    if(spIm.n_rows!=15 || spIm.n_cols!=20 || spIm.n_nonzero!=nOccupied)
+        throw SRRenderError("TestFailure", "renderHistSparse SpMat size");
+}
+
+void test2DGaussFFT()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(400, 48., 0.8); //One pixel sigma
+    for(int n=0; n<100; n++) points(n,3) = 1.6; //Two distinct sigmas
+    mat im(48,64), fft(48,64);
+    SRRender2D<double>::renderGauss(points, roi, im, 5., SRRender2D<double>::Engine::Single);
+    SRRender2D<double>::renderGauss(points, roi, fft, 5., SRRender2D<double>::Engine::FFT);
+    checkClose(im, fft, 0.01*im.max(), "renderGauss Engine::FFT");
+    CostModel cheapFFT; //Auto must stay exact even when the approximate FFT engine looks fastest
+    cheapFFT.fftNs = 0;
+    CostModel::set_global(cheapFFT);
+    mat wide = simulatePoints(400, 48., 2.);
+    mat autoIm(48,64);
+    SRRender2D<double>::renderGauss(wide, roi, im, 5., SRRender2D<double>::Engine::Single);
+    SRRender2D<double>::renderGauss(wide, roi, autoIm, 5.);
+    CostModel::set_global(CostModel());
+    checkClose(im, autoIm, 1e-12*im.max(), "renderGauss Engine::Auto");
+    expect_throws([&]{ SRRender2D<double>::renderHist(points, roi, im, SRRender2D<double>::Engine::FFT); },
+                  "renderHist accepted Engine::FFT");
+}
+
+void test2DStencilTable()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(50, 48., 0.3);
+    StencilTable<double> table(0.5, 4., 64, 128, 5.);
+    mat exact(300,400), tabled(300,400);
+    SRRender2D<double>::renderGauss(points, roi, exact, 5.);
+    SRRender2D<double>::renderGauss(points, roi, tabled, table);
+    checkClose(exact, tabled, 0.01*exact.max(), "renderGauss StencilTable");
+}
+
+void test2DErrorBudget()
+{
+    using RenderT = SRRender2D<double>;
+    vec roi={0., 64., 0., 48.};
+    default_random_engine generator;
+    uniform_real_distribution<double> jitter(0.,1.);
+    mat points(30,5); //Emitters 10 units apart, so only one emitter reaches any pixel above the tolerance
+    for(int n=0; n<30; n++) {
+        points(n,0) = std::pow(10., 4.*n/29);
+        points(n,1) = 7+10*(n%6)+jitter(generator);
+        points(n,2) = 4+10*(n/6)+jitter(generator);
+        points(n,3) = 0.1+0.05*(n%7);
+        points(n,4) = 0.1+0.07*(n%5);
+    }
+    mat exact(96,128), im(96,128), other(96,128);
+    RenderT::renderGauss(points, roi, exact, 12., RenderT::Engine::Single);
+    RenderT::ErrorBudget budget;
+    budget.kind = RenderT::ErrorBudget::Kind::Absolute;
+    budget.tolerance = 0.01;
+    RenderT::renderGauss(points, roi, im, budget, RenderT::Engine::Single);
+    checkClose(im, exact, 0.01, "renderGauss ErrorBudget Absolute");
+    if(abs(im-exact).max()==0) throw SRRenderError("TestFailure", "renderGauss ErrorBudget did not truncate");
+    for(auto engine: {RenderT::Engine::Parallel, RenderT::Engine::Tiled, RenderT::Engine::Auto}) {
+        RenderT::renderGauss(points, roi, other, budget, engine);
+        checkClose(other, im, 1e-12, "renderGauss ErrorBudget Engine");
+    }
+    budget.kind = RenderT::ErrorBudget::Kind::Relative;
+    budget.tolerance = 1e-4;
+    RenderT::renderGauss(points, roi, im, budget);
+    checkClose(im, exact, 1e-4*points(29,0), "renderGauss ErrorBudget Relative"); //No peak exceeds the brightest I
+    expect_throws([&]{ RenderT::renderGauss(points, roi, im, budget, RenderT::Engine::FFT); },
+                  "renderGauss accepted an ErrorBudget with Engine::FFT");
+}
+
+void test2DMovie()
+{
+    vec roi={0., 64., 0., 48.};
+    mat framePoints[2] = {simulatePoints(20, 48., 0.3), simulatePoints(300, 48., 0.2)};
+    mat points(320,6);
+    for(int n=0; n<320; n++) for(int c=0; c<5; c++) points(n,c) = n<20 ? framePoints[0](n,c) : framePoints[1](n-20,c);
+    for(int n=0; n<320; n++) points(n,5) = n<20 ? 0 : 2;
+    cube movie(300,400,3,fill::zeros), histMovie(300,400,3,fill::zeros);
+    SRRender2D<double>::renderGaussMovie(points, roi, movie, 5.);
+    SRRender2D<double>::renderHistMovie(points, roi, histMovie);
+    mat im(300,400);
+    for(int f=0; f<2; f++) {
+        SRRender2D<double>::renderGauss(framePoints[f], roi, im, 5.);
+        checkClose(movie.slice(2*f), im, 1e-12, "renderGaussMovie");
+        im.zeros();
+        SRRender2D<double>::renderHist(framePoints[f], roi, im);
+        checkClose(histMovie.slice(2*f), im, 1e-12, "renderHistMovie");
+    }
+    if(accu(movie.slice(1))!=0) throw SRRenderError("TestFailure", "renderGaussMovie wrote to empty frame");
+}
+
+void test2DMovieWindowed()
+{
+    vec roi={0., 32., 0., 24.};
+    mat framePoints = simulatePoints(400, 24., 0.3);
+    mat points(400,6);
+    for(int n=0; n<400; n++) for(int c=0; c<5; c++) points(n,c) = framePoints(n,c);
+    for(int n=0; n<400; n++) points(n,5) = n%9;
+    cube frames(60,80,9,fill::zeros), histFrames(60,80,9,fill::zeros);
+    SRRender2D<double>::renderGaussMovie(points, roi, frames, 4.);
+    SRRender2D<double>::renderHistMovie(points, roi, histFrames);
+    for(unsigned stride: {1u, 2u, 4u}) {
+        unsigned nOut = (9-3)/stride+1;
+        cube movie(60,80,nOut), histMovie(60,80,nOut);
+        SRRender2D<double>::renderGaussMovieWindowed(points, roi, movie, 3, stride, 4.);
+        SRRender2D<double>::renderHistMovieWindowed(points, roi, histMovie, 3, stride);
+        for(unsigned k=0; k<nOut; k++) {
+            mat im(60,80,fill::zeros), hist(60,80,fill::zeros);
+            for(unsigned f=k*stride; f<k*stride+3; f++) { im += frames.slice(f); hist += histFrames.slice(f); }
+            checkClose(movie.slice(k), im, 1e-9, "renderGaussMovieWindowed");
+            checkClose(histMovie.slice(k), hist, 1e-9, "renderHistMovieWindowed");
+        }
+    }
+}
+
+void test2DMovieStream()
+{
+    using RenderT = SRRender2D<double>;
+    vec roi={0., 32., 0., 24.};
+    mat framePoints = simulatePoints(400, 24., 0.3);
+    mat points(400,6);
+    for(int n=0; n<400; n++) for(int c=0; c<5; c++) points(n,c) = framePoints(n,c);
+    for(int n=0; n<400; n++) points(n,5) = n*7/400; //Sorted by frame, with frames 7 to 9 empty
+    cube frames(60,80,10,fill::zeros), histFrames(60,80,10,fill::zeros);
+    RenderT::renderGaussMovie(points, roi, frames, 4.);
+    RenderT::renderHistMovie(points, roi, histFrames);
+    for(unsigned inFlight: {0u, 1u, 3u, 16u}) {
+        cube movie(60,80,10), histMovie(60,80,10);
+        unsigned next = 0, histNext = 0;
+        RenderT::renderGaussMovieStream(points, roi, 80, 60, 10, [&](uint32_t frame, const mat &im) {
+            if(frame!=next++) throw SRRenderError("TestFailure", "renderGaussMovieStream frames out of order");
+            movie.slice(frame) = im;
+        }, 4., inFlight);
+        RenderT::renderHistMovieStream(points, roi, 80, 60, 10, [&](uint32_t frame, const mat &im) {
+            if(frame!=histNext++) throw SRRenderError("TestFailure", "renderHistMovieStream frames out of order");
+            histMovie.slice(frame) = im;
+        }, inFlight);
+        if(next!=10 || histNext!=10) throw SRRenderError("TestFailure", "Movie stream did not pass every frame");
+        for(int f=0; f<10; f++) {
+            checkClose(movie.slice(f), frames.slice(f), 1e-12, "renderGaussMovieStream");
+            checkClose(histMovie.slice(f), histFrames.slice(f), 0, "renderHistMovieStream");
+        }
+    }
+    struct SinkFailure : std::runtime_error {
+        SinkFailure() : std::runtime_error("Sink failed") {}
+    };
+    for(unsigned inFlight: {0u, 1u, 2u, 16u}) {
+        unsigned passed = 0;
+        expect_throws<SinkFailure>([&]{
+            RenderT::renderHistMovieStream(points, roi, 80, 60, 10, [&](uint32_t frame, const mat&) {
+                if(frame!=passed++) throw SRRenderError("TestFailure", "renderHistMovieStream frames out of order");
+                if(frame==4) throw SinkFailure();
+            }, inFlight);
+        }, "Movie stream did not rethrow the sink's exception");
+        if(passed!=5) throw SRRenderError("TestFailure", "Movie stream passed frames after the sink failed");
+    }
+    points(10,5) = 5;
+    expect_throws([&]{ RenderT::renderHistMovieStream(points, roi, 80, 60, 10, [](uint32_t, const mat&) {}); },
+                  "Movie stream accepted unsorted frames");
+}
+
+void test2DChannels()
+{
+    vec roi={0., 64., 0., 48.};
+    mat channelPoints = simulatePoints(600, 48., 0.3);
+    mat points(600,6);
+    for(int n=0; n<600; n++) for(int c=0; c<5; c++) points(n,c) = channelPoints(n,c);
+    for(int n=0; n<600; n++) points(n,5) = n%3;
+    cube frames(300,400,3), histFrames(300,400,3), channels(300,400,3), histChannels(300,400,3);
+    SRRender2D<double>::renderGaussMovie(points, roi, frames, 5.);
+    SRRender2D<double>::renderHistMovie(points, roi, histFrames);
+    SRRender2D<double>::renderGaussChannels(points, roi, channels, 5.);
+    SRRender2D<double>::renderHistChannels(points, roi, histChannels);
+    for(int c=0; c<3; c++) {
+        checkClose(channels.slice(c), frames.slice(c), 1e-12, "renderGaussChannels");
+        checkClose(histChannels.slice(c), histFrames.slice(c), 1e-12, "renderHistChannels");
+    }
+    mat colors={{1., 0., 0.5}, {0., 1., 0.5}, {0., 0., 0.}}; //Channel 2 is not drawn
+    cube rgb(300,400,3), histRGB(300,400,3);
+    SRRender2D<double>::renderGaussChannels(points, roi, rgb, colors, 5.);
+    SRRender2D<double>::renderHistChannels(points, roi, histRGB, colors);
+    for(int k=0; k<3; k++) {
+        mat im(300,400,fill::zeros), hist(300,400,fill::zeros);
+        for(int c=0; c<3; c++) { im += colors(c,k)*frames.slice(c); hist += colors(c,k)*histFrames.slice(c); }
+        checkClose(rgb.slice(k), im, 1e-12, "renderGaussChannels weighted");
+        checkClose(histRGB.slice(k), hist, 1e-12, "renderHistChannels weighted");
+    }
+    cube wrong(300,400,2);
+    expect_throws([&]{ SRRender2D<double>::renderGaussChannels(points, roi, wrong, colors, 5.); },
+                  "renderGaussChannels accepted weights with the wrong number of slices");
+}
+
+void test2DIndexed()
+{
+    mat points = simulatePoints(20000, 256., 0.4);
+    SRIndexedRender2D<double> index(points);
+    vec fullROI={0., 256., 0., 256.};
+    vec roi={100., 116., 40., 52.};
+    mat im(96,128), expected(96,128);
+    index.renderGauss(roi, im, 5., SRRender2D<double>::Engine::Single);
+    SRRender2D<double>::renderGauss(points, roi, expected, 5., SRRender2D<double>::Engine::Single);
+    checkClose(im, expected, 1e-12, "SRIndexedRender2D renderGauss");
+    if(index.count_visible(roi, im, 5.) > points.n_rows/20)
+        throw SRRenderError("TestFailure", "SRIndexedRender2D visits too many points for a small ROI");
+    index.renderHist(roi, im);
+    SRRender2D<double>::renderHist(points, roi, expected);
+    checkClose(im, expected, 0, "SRIndexedRender2D renderHist");
+    mat full(256,256), fullExpected(256,256);
+    index.renderGauss(fullROI, full, 5.);
+    SRRender2D<double>::renderGauss(points, fullROI, fullExpected, 5.);
+    checkClose(full, fullExpected, 1e-12, "SRIndexedRender2D full ROI");
+    vec outside={300., 310., 300., 310.};
+    index.renderGauss(outside, im, 5.);
+    if(accu(im)!=0) throw SRRenderError("TestFailure", "SRIndexedRender2D rendered outside the points");
+}
+
+void test2DAsync()
+{
+    using AsyncT = SRAsyncRender2D<double>;
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(30000, 48., 0.3);
+    mat expected(300,400), hist(300,400);
+    SRRender2D<double>::renderGauss(points, roi, expected, 5., SRRender2D<double>::Engine::Single);
+    SRRender2D<double>::renderHist(points, roi, hist, SRRender2D<double>::Engine::Single);
+    AsyncT gauss(points, roi, 400, 300, AsyncT::Mode::Gauss, 5.);
+    AsyncT histAsync(points, roi, 400, 300, AsyncT::Mode::Hist);
+    mat preview = gauss.snapshot();
+    if(preview.n_rows!=300 || preview.n_cols!=400) throw SRRenderError("TestFailure", "SRAsyncRender2D snapshot size");
+    gauss.wait();
+    histAsync.wait();
+    if(!gauss.done() || gauss.progress()!=1 || gauss.cancelled())
+        throw SRRenderError("TestFailure", "SRAsyncRender2D not finished after wait");
+    checkClose(gauss.snapshot(), expected, 1e-9, "SRAsyncRender2D Gauss");
+    checkClose(histAsync.snapshot(), hist, 1e-9, "SRAsyncRender2D Hist");
+
+    AsyncT cancelled(points, roi, 400, 300);
+    cancelled.cancel();
+    cancelled.wait();
+    //The render may finish before the cancel arrives, but must stop on a batch boundary either way
+    std::size_t rendered = cancelled.get_num_rendered();
+    if(!cancelled.done() || cancelled.cancelled()!=(rendered<points.n_rows) ||
+       (rendered<points.n_rows && rendered%AsyncT::FirstBatchSize!=0))
+        throw SRRenderError("TestFailure", "SRAsyncRender2D cancel");
+    { AsyncT abandoned(points, roi, 400, 300); } //Destructor cancels and joins
+    expect_throws([&]{ AsyncT bad(points.cols(0,2), roi, 400, 300, AsyncT::Mode::Gauss); },
+                  "SRAsyncRender2D accepted points without sigmas");
+}
+
+void test2DAccumulator()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(6000, 48., 0.3);
+    SRAccumulator2D<double> acc(roi, 400, 300);
+    mat batch(3000,5);
+    for(int b=0; b<2; b++) {
+        for(int n=0; n<3000; n++) for(int c=0; c<5; c++) batch(n,c) = points(b*3000+n,c);
+        acc.add(batch);
+    }
+    mat im(300,400);
+    SRRender2D<double>::renderGauss(points, roi, im, 5.);
+    checkClose(acc.get_image(), im, 1e-10, "SRAccumulator2D");
+    acc.reset();
+    if(acc.get_num_points()!=0 || accu(acc.snapshot())!=0) throw SRRenderError("TestFailure", "SRAccumulator2D reset");
+
+    //A small serial batch followed by a batch large enough for the parallel tiled path, which must add to the image
+    RenderOptions options;
+    options.threads = 4;
+    RenderOptionsScope scope(options);
+    int large = SRAccumulator2D<double>::ParallelBatchSize + 904;
+    mat small(6000-large,5), big(large,5);
+    for(int n=0; n<6000; n++) for(int c=0; c<5; c++) (n<6000-large ? small(n,c) : big(n-(6000-large),c)) = points(n,c);
+    mat hist(300,400);
+    SRRender2D<double>::renderHist(points, roi, hist);
+    for(auto mode: {SRAccumulator2D<double>::Mode::Gauss, SRAccumulator2D<double>::Mode::Hist}) {
+        SRAccumulator2D<double> parallel(roi, 400, 300, mode, 5.);
+        parallel.add(small);
+        parallel.add(big);
+        if(mode==SRAccumulator2D<double>::Mode::Gauss) checkClose(parallel.get_image(), im, 1e-10, "SRAccumulator2D parallel batch");
+        else checkClose(parallel.get_image(), hist, 1e-10, "SRAccumulator2D parallel hist batch");
+    }
+
+    std::vector<double> memory(300*400, 1.);
+    SRAccumulator2D<double> external(roi, 400, 300, memory.data());
+    external.add(points);
+    checkClose(mat(memory.data(), 300, 400), im, 1e-10, "SRAccumulator2D external memory");
+}
+
+void test2DPointView()
+{
+    static_assert(!is_convertible<const mat&, PointView<double>>::value, "PointView must not convert implicitly");
+    static_assert(!is_constructible<PointView<double>, mat&&>::value, "PointView must not view a temporary");
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(500, 48., 0.3);
+    //Array-of-structs [X Y I] in double with a constant sigma
+    vector<double> xyi(3*points.n_rows);
+    for(uword n=0; n<points.n_rows; n++) { xyi[3*n]=points(n,1); xyi[3*n+1]=points(n,2); xyi[3*n+2]=points(n,0); }
+    PointView<double> view(points.n_rows);
+    view.set_column(PointField::X, &xyi[0], 3).set_column(PointField::Y, &xyi[1], 3).set_column(PointField::I, &xyi[2], 3);
+    view.set_constant(PointField::SigmaX, 0.3).set_constant(PointField::SigmaY, 0.3);
+    mat im(300,400), viewIm(300,400);
+    SRRender2D<double>::renderGauss(points, roi, im, 5.);
+    SRRender2D<double>::renderGauss(view, roi, viewIm, 5.);
+    checkClose(im, viewIm, 1e-12, "renderGauss PointView");
+    //Double points rendered into a float image
+    fmat fim(300,400);
+    SRRender2D<float>::renderGaussTiled(view, fvec{0.f, 64.f, 0.f, 48.f}, fim, 5.f, 64);
+    checkClose(conv_to<mat>::from(fim), im, 1e-4, "renderGaussTiled mixed precision");
+    mat noSigma = points.cols(0,2);
+    expect_throws([&]{ SRRender2D<double>::renderGauss(PointView<double>(noSigma), roi, im); },
+                  "renderGauss accepted points without sigma");
+}
+
+void test2DPyramid()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(400, 48., 0.4);
+    SRRender2D<double>::PyramidT pyramid;
+    SRRender2D<double>::renderGaussPyramid(points, roi, 203, 151, 3, pyramid, 12.);
+    mat im(151,203);
+    SRRender2D<double>::renderGauss(points, roi, im, 12.);
+    checkClose(pyramid(0), im, 1e-12, "renderGaussPyramid level 0");
+    for(uword level=1; level<3; level++) {
+        mat coarse(pyramid(level).n_rows, pyramid(level).n_cols);
+        SRRender2D<double>::renderGauss(points, SRRender2D<double>::pyramidROI(roi, 203, 151, level), coarse, 12.);
+        checkClose(pyramid(level), coarse, 1e-10, "renderGaussPyramid coarse level");
+    }
+    auto tiles = SRRender2D<double>::pyramidTiles(pyramid(1), 64);
+    if(tiles.n_rows!=2 || tiles.n_cols!=2 || tiles(1,1)(0,0)!=pyramid(1)(64,64) || tiles(1,1)(63,63)!=0)
+        throw SRRenderError("TestFailure", "pyramidTiles");
+    SRRender2D<double>::renderGaussPyramid(points, roi, 203, 151, 9, pyramid, 12.); //Coarsest level is 1x1
+    if(pyramid(8).n_rows!=1 || pyramid(8).n_cols!=1) throw SRRenderError("TestFailure", "renderGaussPyramid coarsest level");
+    expect_throws([&]{ SRRender2D<double>::renderGaussPyramid(points, roi, 203, 151, 10, pyramid, 12.); },
+                  "renderGaussPyramid accepted levels coarser than one pixel");
+}
+
+void test3D()
+{
+    vec roi={0., 64., 0., 48., -8., 8.};
+    mat points2D = simulatePoints(300, 48., 0.5);
+    mat points(300,7);
+    for(int n=0; n<300; n++) {
+        points(n,0) = points2D(n,0);
+        points(n,1) = points2D(n,1);
+        points(n,2) = points2D(n,2);
+        points(n,3) = points2D(n,1)/4-6; //Spread over z, away from the volume faces
+        points(n,4) = points2D(n,3);
+        points(n,5) = points2D(n,4);
+        points(n,6) = 0.25;
+    }
+    cube vol(48,64,16), hist(48,64,16);
+    SRRender3D<double>::renderGauss(points, roi, vol, 5.);
+    SRRender3D<double>::renderHist(points, roi, hist);
+    //Summing the Gaussian volume over z gives the 2D Gaussian image when no stencil is clipped in z
+    mat im(48,64), projection(48,64);
+    SRRender2D<double>::renderGauss(points2D, roi, im, 5.);
+    projection.zeros();
+    for(uword z=0; z<vol.n_slices; z++) projection += vol.slice(z);
+    checkClose(im, projection, 1e-3, "SRRender3D::renderGauss projection");
+    if(std::abs(accu(hist)-300)>1e-9) throw SRRenderError("TestFailure", "SRRender3D::renderHist total");
+}
+
+void testRenderStats()
+{
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(500, 48., 0.3);
+    points(0,1) = -100.;
+    mat im(300,400);
+    RenderStats stats;
+    {
+        RenderStatsScope scope(stats);
+        SRRender2D<double>::renderGauss(points, roi, im, 5., SRRender2D<double>::Engine::Single);
+        SRRender2D<double>::renderGaussTiled(points, roi, im, 5., 64);
+    }
+    SRRender2D<double>::renderGauss(points, roi, im, 5.);
+    if(RenderStats::Enabled) {
+        if(stats.renders!=2 || stats.pointsClipped!=2 || stats.pointsRendered!=998 || stats.threads<1)
+            throw SRRenderError("TestFailure", "RenderStats counts");
+        if(stats.stencilPixels==0 || stats.scratchBytes==0 || !(stats.splatSeconds>0) || !(stats.totalSeconds>0))
+            throw SRRenderError("TestFailure", "RenderStats not recorded");
+    } else if(stats.renders!=0 || stats.stencilPixels!=0) {
+        throw SRRenderError("TestFailure", "RenderStats recorded while disabled");
+    }
+
+    //Points in channels with all zero weights are skipped, not clipped
+    mat channelPoints(500,6);
+    for(int n=0; n<500; n++) for(int c=0; c<5; c++) channelPoints(n,c) = points(n,c);
+    for(int n=0; n<500; n++) channelPoints(n,5) = n%3; //Channels 0 and 1 have 167 points, channel 2 has 166
+    mat colors={{1., 0.}, {0., 1.}, {0., 0.}};
+    cube rgb(300,400,2);
+    RenderStats channelStats;
+    {
+        RenderStatsScope scope(channelStats);
+        SRRender2D<double>::renderGaussChannels(channelPoints, roi, rgb, colors, 5.);
+    }
+    if(RenderStats::Enabled && (channelStats.pointsClipped!=1 || channelStats.pointsRendered!=333))
+        throw SRRenderError("TestFailure", "RenderStats counts for renderGaussChannels");
+}
+
+void testRenderOptions()
+{
+    using Engine = SRRender2D<double>::Engine;
+    vec roi={0., 64., 0., 48.};
+    mat points = simulatePoints(2000, 48., 0.3);
+    mat expected(300,400), hist(300,400), im(300,400);
+    SRRender2D<double>::renderGauss(points, roi, expected, 5., Engine::Single);
+    SRRender2D<double>::renderHist(points, roi, hist, Engine::Single);
+    RenderOptions options;
+    options.threads = 3;
+    options.affinity = RenderOptions::Affinity::Spread;
+    options.firstTouch = true;
+    RenderStats stats;
+    {
+        RenderOptionsScope scope(options);
+        RenderStatsScope statsScope(stats);
+        if(RenderOptionsScope::threads()!=3) throw SRRenderError("TestFailure", "RenderOptions threads not active");
+        for(auto engine: {Engine::Parallel, Engine::Tiled}) {
+            SRRender2D<double>::renderGauss(points, roi, im, 5., engine);
+            checkClose(im, expected, 1e-12, "renderGauss with RenderOptions");
+            SRRender2D<double>::renderHist(points, roi, im, engine);
+            checkClose(im, hist, 0, "renderHist with RenderOptions");
+        }
+        SRRender2D<double>::renderHistSparse(points, roi, im);
+        checkClose(im, hist, 0, "renderHistSparse with RenderOptions");
+        RenderOptions serial;
+        serial.threads = 1;
+        RenderOptionsScope inner(serial);
+        if(RenderOptionsScope::threads()!=1) throw SRRenderError("TestFailure", "Nested RenderOptionsScope not active");
+    }
+    if(RenderOptionsScope::active().threads!=0 || RenderOptionsScope::active().firstTouch)
+        throw SRRenderError("TestFailure", "RenderOptionsScope not restored");
+    if(RenderStats::Enabled && stats.threads!=3) throw SRRenderError("TestFailure", "RenderOptions thread count not used");
+}
+
+void testCostModel()
+{
+    CostModel model;
+    model.pointNs = 12.5;
+    model.memNsPerByte = 0.25;
+    std::string path = "test_srrender_costmodel.txt";
+    model.save(path);
+    CostModel loaded = CostModel::load(path);
+    std::remove(path.c_str());
+    if(loaded.pointNs!=model.pointNs || loaded.memNsPerByte!=model.memNsPerByte || loaded.binNs!=model.binNs)
+        throw SRRenderError("TestFailure", "CostModel save/load");
+
+    CostModel::Problem problem; //Few points in a huge image: per-thread images cost more than they save
+    problem.nPoints = 1000;
+    problem.pixelsX = problem.pixelsY = 8192;
+    problem.threads = 8;
+    auto costs = model.estimate(problem);
+    if(costs.parallel<=costs.single || costs.parallel<=costs.tiled)
+        throw SRRenderError("TestFailure", "CostModel chose Parallel for a sparse image");
+    problem.threads = 1;
+    costs = model.estimate(problem);
+    if(costs.single>costs.parallel || costs.single>costs.tiled)
+        throw SRRenderError("TestFailure", "CostModel did not choose Single for one thread");
+}
+
+template<class FloatT>
+void testKernels(FloatT erfTol)
+{
+    using namespace srrender::kernels;
+    default_random_engine generator;
+    uniform_real_distribution<FloatT> dist(-7.,7.);
+    const size_t n = 1003;
+    vector<FloatT> x(n), scalarErf(n), erfOut(n);
+    for(auto &v: x) v = dist(generator);
+    erf_array(ISA::Scalar, n, x.data(), scalarErf.data());
+    for(size_t i=0; i<n; i++) if(std::abs(scalarErf[i]-std::erf(x[i])) > erfTol)
+        throw SRRenderError("TestFailure", "erf_array error too large at x="+to_string(x[i]));
+
+    const size_t ld=37, nx=13, ny=29;
+    vector<FloatT> xs(nx), ys(ny), scalarIm(ld*nx), im(ld*nx);
+    for(auto &v: xs) v = dist(generator);
+    for(auto &v: ys) v = dist(generator);
+    for(auto &v: scalarIm) v = dist(generator);
+    vector<FloatT> im0 = scalarIm;
+    splat_rank1(ISA::Scalar, scalarIm.data()+3, ld, nx, ny, FloatT(1.7), xs.data(), ys.data());
+    for(ISA isa : {ISA::AVX2, ISA::AVX512}) {
+        if(!isa_supported(isa)) continue;
+        erf_array(isa, n, x.data(), erfOut.data());
+        if(memcmp(erfOut.data(), scalarErf.data(), n*sizeof(FloatT)))
+            throw SRRenderError("TestFailure", string("erf_array not bit-identical for ")+isa_name(isa));
+        im = im0;
+        splat_rank1(isa, im.data()+3, ld, nx, ny, FloatT(1.7), xs.data(), ys.data());
+        if(memcmp(im.data(), scalarIm.data(), im.size()*sizeof(FloatT)))
+            throw SRRenderError("TestFailure", string("splat_rank1 not bit-identical for ")+isa_name(isa));
+    }
+}
 
 int main(){
     test2D();
+    test2DTiled();
+    test2DHistSparse();
+    test2DGaussFFT();
+    test2DStencilTable();
+    test2DErrorBudget();
+    test2DMovie();
+    test2DMovieWindowed();
+    test2DMovieStream();
+    test2DChannels();
+    test2DIndexed();
+    test2DAsync();
+    test2DAccumulator();
+    test2DPointView();
+    test2DPyramid();
+    test3D();
+    testRenderStats();
+    testRenderOptions();
+    testCostModel();
+    testKernels<float>(4e-7);
+    testKernels<double>(1e-15);
     return 0;
 }